@@ -0,0 +1,130 @@
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <random>
+#include <chrono>
+#include <limits>
+
+#include "MLCPSolverVanillaPGS.hpp"
+
+// Micro-benchmark of the dense sweep of MLCPSolverVanillaPGS<float>.
+// The tiled kernel is compared with the scalar sweep of the full row-major M,
+// which was the dense kernel before the packed tiles.
+//
+//   $ cmake -DSAMPLE_APP_01_BENCHMARK=ON -DSAMPLE_APP_01_NATIVE_ARCH=ON ..
+//   $ make benchmark_dense_pgs && ./benchmark_dense_pgs
+
+static constexpr int32_t NUM_SWEEPS = 20;
+
+// A dense SPD matrix like J W J^T of the contacts: unit diagonal plus small couplings.
+static void makeProblem( const int32_t dim, std::vector<float>& M, std::vector<float>& q )
+{
+    std::mt19937                          rng( 1 );
+    std::uniform_real_distribution<float> u( -1.0f, 1.0f );
+
+    M.assign( dim * dim, 0.0f );
+    q.resize( dim );
+
+    for ( int32_t i = 0; i < dim; i++ ) {
+
+        for ( int32_t j = 0; j < i; j++ ) {
+
+            const float v = u( rng ) / dim;
+
+            M[ i * dim + j ] = v;
+            M[ j * dim + i ] = v;
+        }
+        M[ i * dim + i ] = 1.0f;
+        q[ i ]           = u( rng );
+    }
+}
+
+static double sweepFullRowMajor( const int32_t dim, const std::vector<float>& M, const std::vector<float>& q )
+{
+    std::vector<float> z( dim, 0.0f );
+
+    float error = 0.0f;
+
+    const auto t0 = std::chrono::steady_clock::now();
+
+    for ( int32_t k = 0; k < NUM_SWEEPS; k++ ) {
+
+        for ( int32_t row = 0; row < dim; row++ ) {
+
+            float dot = 0.0f;
+
+            for ( int32_t col = 0; col < dim; col++ ) {
+
+                dot += M[ row * dim + col ] * z[ col ];
+            }
+
+            const float diag   = M[ row * dim + row ];
+            const float z_prev = z[ row ];
+
+            z[ row ] = std::max( 0.0f, z_prev - ( dot + q[ row ] ) / diag );
+
+            error += std::abs( z[ row ] - z_prev ) * diag;
+        }
+    }
+
+    const auto t1 = std::chrono::steady_clock::now();
+
+    // keeps the loop from being optimized out.
+    if ( error < 0.0f ) {
+        std::cout << error;
+    }
+
+    return std::chrono::duration<double, std::milli>( t1 - t0 ).count() / NUM_SWEEPS;
+}
+
+static double sweepTiled( const int32_t dim, const std::vector<float>& M, const std::vector<float>& q )
+{
+    // runs exactly NUM_SWEEPS sweeps.
+    MLCPSolverVanillaPGS<float> solver( 0.0f, NUM_SWEEPS, NUM_SWEEPS );
+
+    solver.convergencePolicy().setRelativeTolerance( 0.0f );
+    solver.convergencePolicy().setCheckInterval( 1 );
+    solver.prepare( dim, MLCPSolverVanillaPGS<float>::Dense );
+
+    for ( int32_t i = 0; i < dim; i++ ) {
+
+        solver.setUnilateralLimits( i );
+        solver.setQ( i, q[ i ] );
+
+        for ( int32_t j = 0; j < dim; j++ ) {
+
+            solver.setM( i, j, M[ i * dim + j ] );
+        }
+    }
+
+    const auto t0 = std::chrono::steady_clock::now();
+
+    solver.run();
+
+    const auto t1 = std::chrono::steady_clock::now();
+
+    return std::chrono::duration<double, std::milli>( t1 - t0 ).count() / solver.getIterations();
+}
+
+int main()
+{
+    std::cout << "   dim  full(ms/sweep)  tiled(ms/sweep)  speedup\n";
+
+    for ( int32_t dim = 64; dim <= 4096; dim *= 2 ) {
+
+        std::vector<float> M;
+        std::vector<float> q;
+
+        makeProblem( dim, M, q );
+
+        const double t_full  = sweepFullRowMajor( dim, M, q );
+        const double t_tiled = sweepTiled( dim, M, q );
+
+        std::cout << std::setw( 6 )  << dim
+                  << std::setw( 16 ) << std::fixed << std::setprecision( 4 ) << t_full
+                  << std::setw( 17 ) << t_tiled
+                  << std::setw( 9 )  << std::setprecision( 2 ) << t_full / t_tiled << "\n";
+    }
+
+    return 0;
+}
@@ -1,4 +1,5 @@
 #include <iostream>
+#include <string>
 
 #include <GL/glew.h>
 #include <GLFW/glfw3.h>
@@ -6,12 +7,65 @@
 #include <glm/gtc/matrix_transform.hpp>
 
 #include "Simulator.hpp"
+#include "ConstraintsSolverConfig.hpp"
+#include "ConstraintsRecorder.hpp"
 #include "UserInput.hpp"
 #include "OpenGLRenderer.hpp"
 
+// --config <path> : loads ConstraintsSolverConfig, e.g. the output of tune_solver.
+// --record <path> : records the input of the constraints solver, and saves it on exit.
+// --broadphase <hash_grid|sweep_and_prune|aabb_tree|verlet_list>
 int main( int argc, char* argv[] )
 {
-    Simulator sim;
+    Simulator           sim;
+    ConstraintsRecorder recorder;
+    std::string         record_path;
+
+    for ( int i = 1; i + 1 < argc; i += 2 ) {
+
+        const std::string flag{ argv[i] };
+
+        if ( flag == "--config" ) {
+
+            ConstraintsSolverConfig config;
+
+            if ( !config.load( argv[i + 1] ) ) {
+                std::cerr << "can not read config from " << argv[i + 1] << "\n";
+                exit(1);
+            }
+            config.apply( sim.constraintsSolver() );
+        }
+        else if ( flag == "--record" ) {
+
+            record_path = argv[i + 1];
+            sim.setRecorder( &recorder );
+        }
+        else if ( flag == "--broadphase" ) {
+
+            const std::string type{ argv[i + 1] };
+
+            if ( type == "hash_grid" ) {
+                sim.setBroadphase( Simulator::HashGrid );
+            }
+            else if ( type == "sweep_and_prune" ) {
+                sim.setBroadphase( Simulator::SweepAndPrune );
+            }
+            else if ( type == "aabb_tree" ) {
+                sim.setBroadphase( Simulator::AABBTree );
+            }
+            else if ( type == "verlet_list" ) {
+                sim.setBroadphase( Simulator::VerletList );
+            }
+            else {
+                std::cerr << "unknown broadphase " << type << "\n";
+                exit(1);
+            }
+        }
+        else {
+            std::cerr << "unknown option " << flag << "\n";
+            exit(1);
+        }
+    }
 
     if( !glfwInit() ) {
         exit(1);
@@ -82,5 +136,9 @@ int main( int argc, char* argv[] )
 
     glfwTerminate();
 
+    if ( !record_path.empty() && !recorder.save( record_path ) ) {
+        std::cerr << "can not write frames to " << record_path << "\n";
+    }
+
     return 0;
 }
@@ -0,0 +1,72 @@
+#include <iostream>
+#include <string>
+#include <cstdlib>
+
+#include "ConstraintsRecorder.hpp"
+#include "ConstraintsSolverConfig.hpp"
+#include "ConstraintsSolverTuner.hpp"
+#include "MLCPBackend.hpp"
+#include "MLCPSolverAPGD.hpp"
+
+// Offline tuning of the constraints solver on the frames recorded by
+// sample_app_01 --record. The result is loaded by sample_app_01 --config.
+//
+//   $ ./sample_app_01 --record frames.txt
+//   $ ./tune_solver frames.txt 1e-3 solver.cfg
+//   $ ./sample_app_01 --config solver.cfg
+//
+// The tuned config is then compared over the backends, including MLCPSolverAPGD
+// plugged in through MLCPBackendAdapter, which should match the built-in apgd.
+
+int main( int argc, char* argv[] )
+{
+    if ( argc < 4 ) {
+        std::cerr << "usage: " << argv[0] << " <recorded frames> <target violation [m/s]> <output config> [initial config]\n";
+        return 1;
+    }
+
+    ConstraintsRecorder frames;
+
+    if ( !frames.load( argv[1] ) || frames.numFrames() == 0 ) {
+        std::cerr << "can not read frames from " << argv[1] << "\n";
+        return 1;
+    }
+
+    ConstraintsSolverConfig initial;
+
+    if ( argc >= 5 && !initial.load( argv[4] ) ) {
+        std::cerr << "can not read config from " << argv[4] << "\n";
+        return 1;
+    }
+
+    ConstraintsSolverTuner tuner( frames, (float)std::atof( argv[2] ) );
+
+    const auto best = tuner.tune( initial, &std::cerr );
+
+    if ( !best.save( argv[3] ) ) {
+        std::cerr << "can not write config to " << argv[3] << "\n";
+        return 1;
+    }
+
+    best.write( std::cout );
+
+    typedef ConstraintsSolver<float> Solver;
+
+    const auto adapter = tuner.solver().registerBackend(
+        "apgd-adapter",
+        []{ return std::unique_ptr< MLCPBackend<float> >( new MLCPBackendAdapter< float, MLCPSolverAPGD<float> >() ); }
+    );
+
+    tuner.compareBackends(
+        best,
+        { Solver::ProjectedGaussSeidel,
+          Solver::Pivoting,
+          Solver::AcceleratedProjectedGradient,
+          adapter,
+          Solver::Multilevel,
+          Solver::Automatic },
+        &std::cerr
+    );
+
+    return 0;
+}
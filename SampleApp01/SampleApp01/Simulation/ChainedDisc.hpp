@@ -3,16 +3,19 @@
 
 #include "RigidBody.hpp"
 #include "Vec4.hpp"
+#include "CollisionFilter.hpp"
 
 class ChainedDisc : public RigidBody {
 
 public:
     ChainedDisc( const float mass, const float radius, const Vec4& color )
-        :RigidBody{ mass }
-        ,m_radius { radius }
-        ,m_prev   { nullptr }
-        ,m_next   { nullptr }
-        ,m_color  { color }
+        :RigidBody { mass }
+        ,m_radius  { radius }
+        ,m_prev    { nullptr }
+        ,m_next    { nullptr }
+        ,m_color   { color }
+        ,m_category{ CollisionFilter::DEFAULT_CATEGORY }
+        ,m_mask    { CollisionFilter::ALL_CATEGORIES }
     {
     }
 
@@ -25,6 +28,10 @@ public:
 
     ChainedDisc* m_prev;
     ChainedDisc* m_next;
+
+    // see CollisionFilter. Simulator also excludes the pairs of the linked discs.
+    uint32_t     m_category;
+    uint32_t     m_mask;
 };
 
 #endif /*__DISC_HPP__*/
@@ -0,0 +1,392 @@
+#ifndef __AABB_TREE_BROADPHASE_HPP__
+#define __AABB_TREE_BROADPHASE_HPP__
+
+#include <vector>
+#include <utility>
+#include <algorithm>
+#include <cstdint>
+#include <cmath>
+
+#include "Vec2.hpp"
+#include "Broadphase.hpp"
+
+class AABBTreeBroadphase : public Broadphase {
+
+    // Finds the candidate pairs with a dynamic bounding volume tree of the
+    // axis aligned boxes of the discs, for the discs of very different sizes
+    // for which a grid of a fixed cell size does poorly.
+    //
+    // A leaf holds the box of a disc enlarged by half the margin and fattened
+    // by FAT_RATIO of its radius, and is kept as long as the disc stays within. When a disc
+    // moves out, its leaf is refitted to the new fat box and so are the
+    // ancestors up to the root. As the refits loosen the tree, the tree rotations
+    // are applied every ROTATION_PERIOD calls. A rotation swaps a child of a
+    // node with a grandchild under the other child if it reduces the perimeter
+    // of the other child.
+    //
+    // The tree is built top down with the median split along the longer side
+    // when the number of the discs changes.
+    //
+    // The pairs are enumerated by descending the tree against itself, and
+    // then sorted.
+
+public:
+
+    static constexpr float   FAT_RATIO       = 0.25f;
+    static constexpr int32_t ROTATION_PERIOD = 8;
+
+    AABBTreeBroadphase()
+        :m_num_discs { 0 }
+        ,m_root      { NONE }
+        ,m_num_calls { 0 }
+    {
+    }
+
+    virtual ~AABBTreeBroadphase()
+    {
+    }
+
+    void findPairs(
+        const std::vector< Vec2 >&                    centers,
+        const std::vector< float >&                   radii,
+        const float                                   margin,
+        std::vector< std::pair< int32_t, int32_t > >& pairs
+    ) override {
+        pairs.clear();
+
+        if ( (int32_t)centers.size() != m_num_discs ) {
+            rebuild( centers, radii, margin );
+        }
+        else {
+            refit( centers, radii, margin );
+
+            if ( ++m_num_calls % ROTATION_PERIOD == 0 ) {
+                rotate( m_root );
+            }
+        }
+
+        if ( m_root != NONE ) {
+            findPairsWithin( m_root, centers, radii, margin, pairs );
+        }
+
+        std::sort( pairs.begin(), pairs.end() );
+    }
+
+    // The height of the tree, e.g. to see the effect of the rotations.
+    int32_t height() const
+    {
+        return height( m_root );
+    }
+
+private:
+
+    static constexpr int32_t NONE = -1;
+
+    struct Node {
+
+        Vec2    m_lower;
+        Vec2    m_upper;
+        int32_t m_parent;
+        int32_t m_child_0;
+        int32_t m_child_1;
+        int32_t m_disc;     // NONE for the internal nodes.
+    };
+
+    static float perimeter( const Vec2& lower, const Vec2& upper )
+    {
+        return 2.0f * ( ( upper.x - lower.x ) + ( upper.y - lower.y ) );
+    }
+
+    static float unionPerimeter( const Node& a, const Node& b )
+    {
+        return perimeter(
+            Vec2{ std::min( a.m_lower.x, b.m_lower.x ), std::min( a.m_lower.y, b.m_lower.y ) },
+            Vec2{ std::max( a.m_upper.x, b.m_upper.x ), std::max( a.m_upper.y, b.m_upper.y ) }
+        );
+    }
+
+    bool isLeaf( const int32_t node ) const
+    {
+        return m_nodes[ node ].m_disc != NONE;
+    }
+
+    // Returns true if the box has changed.
+    bool updateBox( const int32_t node )
+    {
+        auto&       n  = m_nodes[ node ];
+        const auto& c0 = m_nodes[ n.m_child_0 ];
+        const auto& c1 = m_nodes[ n.m_child_1 ];
+
+        const Vec2 lower{ std::min( c0.m_lower.x, c1.m_lower.x ), std::min( c0.m_lower.y, c1.m_lower.y ) };
+        const Vec2 upper{ std::max( c0.m_upper.x, c1.m_upper.x ), std::max( c0.m_upper.y, c1.m_upper.y ) };
+
+        if (    lower.x == n.m_lower.x && lower.y == n.m_lower.y
+             && upper.x == n.m_upper.x && upper.y == n.m_upper.y
+        ) {
+            return false;
+        }
+
+        n.m_lower = lower;
+        n.m_upper = upper;
+
+        return true;
+    }
+
+    void setFatBox( const int32_t node, const Vec2& center, const float radius, const float margin )
+    {
+        const auto half = radius + 0.5f * margin + FAT_RATIO * radius;
+
+        m_nodes[ node ].m_lower = Vec2{ center.x - half, center.y - half };
+        m_nodes[ node ].m_upper = Vec2{ center.x + half, center.y + half };
+    }
+
+    void rebuild( const std::vector< Vec2 >& centers, const std::vector< float >& radii, const float margin )
+    {
+        m_num_discs = (int32_t)centers.size();
+        m_num_calls = 0;
+
+        m_nodes.clear();
+        m_leaves.resize( m_num_discs );
+        m_order.resize( m_num_discs );
+
+        for ( int32_t i = 0; i < m_num_discs; i++ ) {
+            m_order[ i ] = i;
+        }
+
+        m_root = ( m_num_discs > 0 ) ? build( 0, m_num_discs, NONE, centers, radii, margin ) : NONE;
+    }
+
+    // Builds the subtree of the discs in m_order[ begin, end ).
+    int32_t build(
+        const int32_t               begin,
+        const int32_t               end,
+        const int32_t               parent,
+        const std::vector< Vec2 >&  centers,
+        const std::vector< float >& radii,
+        const float                 margin
+    ) {
+        const auto node = (int32_t)m_nodes.size();
+
+        m_nodes.push_back( Node{ Vec2{ 0.0f, 0.0f }, Vec2{ 0.0f, 0.0f }, parent, NONE, NONE, NONE } );
+
+        if ( end - begin == 1 ) {
+
+            const auto disc = m_order[ begin ];
+
+            m_nodes[ node ].m_disc = disc;
+            m_leaves[ disc ]       = node;
+            setFatBox( node, centers[ disc ], radii[ disc ], margin );
+
+            return node;
+        }
+
+        Vec2 lower = centers[ m_order[ begin ] ];
+        Vec2 upper = lower;
+
+        for ( int32_t k = begin + 1; k < end; k++ ) {
+
+            const auto& c = centers[ m_order[ k ] ];
+
+            lower = Vec2{ std::min( lower.x, c.x ), std::min( lower.y, c.y ) };
+            upper = Vec2{ std::max( upper.x, c.x ), std::max( upper.y, c.y ) };
+        }
+
+        const bool along_x = ( upper.x - lower.x ) >= ( upper.y - lower.y );
+        const auto mid     = begin + ( end - begin ) / 2;
+
+        std::nth_element(
+            m_order.begin() + begin,
+            m_order.begin() + mid,
+            m_order.begin() + end,
+            [ &centers, along_x ]( const int32_t a, const int32_t b ) {
+                return along_x ? ( centers[ a ].x < centers[ b ].x ) : ( centers[ a ].y < centers[ b ].y );
+            }
+        );
+
+        const auto child_0 = build( begin, mid, node, centers, radii, margin );
+        const auto child_1 = build( mid,   end, node, centers, radii, margin );
+
+        m_nodes[ node ].m_child_0 = child_0;
+        m_nodes[ node ].m_child_1 = child_1;
+        updateBox( node );
+
+        return node;
+    }
+
+    void refit( const std::vector< Vec2 >& centers, const std::vector< float >& radii, const float margin )
+    {
+        for ( int32_t i = 0; i < m_num_discs; i++ ) {
+
+            const auto  leaf = m_leaves[ i ];
+            const auto& n    = m_nodes[ leaf ];
+            const auto& c    = centers[ i ];
+            const auto  half = radii[ i ] + 0.5f * margin;
+
+            if (    n.m_lower.x <= c.x - half && c.x + half <= n.m_upper.x
+                 && n.m_lower.y <= c.y - half && c.y + half <= n.m_upper.y
+            ) {
+                continue;
+            }
+
+            setFatBox( leaf, c, radii[ i ], margin );
+
+            auto node = n.m_parent;
+
+            while ( node != NONE && updateBox( node ) ) {
+                node = m_nodes[ node ].m_parent;
+            }
+        }
+    }
+
+    // Post order, so that the rotations below see the refined subtrees.
+    void rotate( const int32_t node )
+    {
+        if ( node == NONE || isLeaf( node ) ) {
+            return;
+        }
+
+        rotate( m_nodes[ node ].m_child_0 );
+        rotate( m_nodes[ node ].m_child_1 );
+
+        if ( !rotateChildren( node, m_nodes[ node ].m_child_0, m_nodes[ node ].m_child_1 ) ) {
+            rotateChildren( node, m_nodes[ node ].m_child_1, m_nodes[ node ].m_child_0 );
+        }
+    }
+
+    // Tries to swap child a of node with a child of child b. Returns true if swapped.
+    bool rotateChildren( const int32_t node, const int32_t a, const int32_t b )
+    {
+        if ( isLeaf( b ) ) {
+            return false;
+        }
+
+        const auto b0 = m_nodes[ b ].m_child_0;
+        const auto b1 = m_nodes[ b ].m_child_1;
+
+        const auto current = perimeter( m_nodes[ b ].m_lower, m_nodes[ b ].m_upper );
+        const auto swap_b0 = unionPerimeter( m_nodes[ a ], m_nodes[ b1 ] ); // b0 comes up.
+        const auto swap_b1 = unionPerimeter( m_nodes[ a ], m_nodes[ b0 ] ); // b1 comes up.
+
+        if ( current <= std::min( swap_b0, swap_b1 ) ) {
+            return false;
+        }
+
+        const auto up = ( swap_b0 <= swap_b1 ) ? b0 : b1;
+
+        if ( m_nodes[ node ].m_child_0 == a ) {
+            m_nodes[ node ].m_child_0 = up;
+        }
+        else {
+            m_nodes[ node ].m_child_1 = up;
+        }
+
+        if ( m_nodes[ b ].m_child_0 == up ) {
+            m_nodes[ b ].m_child_0 = a;
+        }
+        else {
+            m_nodes[ b ].m_child_1 = a;
+        }
+
+        m_nodes[ up ].m_parent = node;
+        m_nodes[ a  ].m_parent = b;
+
+        updateBox( b );
+
+        return true;
+    }
+
+    static bool overlap( const Node& a, const Node& b )
+    {
+        return    a.m_lower.x <= b.m_upper.x && b.m_lower.x <= a.m_upper.x
+               && a.m_lower.y <= b.m_upper.y && b.m_lower.y <= a.m_upper.y;
+    }
+
+    // Finds the pairs of the leaves within the subtree.
+    void findPairsWithin(
+        const int32_t                                 node,
+        const std::vector< Vec2 >&                    centers,
+        const std::vector< float >&                   radii,
+        const float                                   margin,
+        std::vector< std::pair< int32_t, int32_t > >& pairs
+    ) const {
+        if ( isLeaf( node ) ) {
+            return;
+        }
+
+        const auto& n = m_nodes[ node ];
+
+        findPairsWithin( n.m_child_0, centers, radii, margin, pairs );
+        findPairsWithin( n.m_child_1, centers, radii, margin, pairs );
+        findPairsBetween( n.m_child_0, n.m_child_1, centers, radii, margin, pairs );
+    }
+
+    // Finds the pairs of the leaves one from each subtree.
+    void findPairsBetween(
+        const int32_t                                 node_a,
+        const int32_t                                 node_b,
+        const std::vector< Vec2 >&                    centers,
+        const std::vector< float >&                   radii,
+        const float                                   margin,
+        std::vector< std::pair< int32_t, int32_t > >& pairs
+    ) const {
+        const auto& a = m_nodes[ node_a ];
+        const auto& b = m_nodes[ node_b ];
+
+        if ( !overlap( a, b ) ) {
+            return;
+        }
+
+        const bool leaf_a = isLeaf( node_a );
+        const bool leaf_b = isLeaf( node_b );
+
+        if ( leaf_a && leaf_b ) {
+
+            const auto i = std::min( a.m_disc, b.m_disc );
+            const auto j = std::max( a.m_disc, b.m_disc );
+            const auto r = radii[ i ] + radii[ j ] + margin;
+
+            if (    std::abs( centers[ i ].x - centers[ j ].x ) <= r
+                 && std::abs( centers[ i ].y - centers[ j ].y ) <= r
+                 && accepts( i, j )
+            ) {
+                pairs.emplace_back( i, j );
+            }
+            return;
+        }
+
+        // Descends into the larger one.
+        if (    leaf_b
+             || ( !leaf_a && perimeter( a.m_lower, a.m_upper ) >= perimeter( b.m_lower, b.m_upper ) )
+        ) {
+            findPairsBetween( a.m_child_0, node_b, centers, radii, margin, pairs );
+            findPairsBetween( a.m_child_1, node_b, centers, radii, margin, pairs );
+        }
+        else {
+            findPairsBetween( node_a, b.m_child_0, centers, radii, margin, pairs );
+            findPairsBetween( node_a, b.m_child_1, centers, radii, margin, pairs );
+        }
+    }
+
+    int32_t height( const int32_t node ) const
+    {
+        if ( node == NONE ) {
+            return 0;
+        }
+        if ( isLeaf( node ) ) {
+            return 1;
+        }
+        return 1 + std::max( height( m_nodes[ node ].m_child_0 ), height( m_nodes[ node ].m_child_1 ) );
+    }
+
+    int32_t                m_num_discs;
+    int32_t                m_root;
+    int32_t                m_num_calls;
+
+    std::vector< Node >    m_nodes;
+    std::vector< int32_t > m_leaves; // per disc
+
+    // work memory
+    std::vector< int32_t > m_order;
+};
+
+#endif /*__AABB_TREE_BROADPHASE_HPP__*/
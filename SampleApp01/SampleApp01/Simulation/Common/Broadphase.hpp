@@ -0,0 +1,60 @@
+#ifndef __BROADPHASE_HPP__
+#define __BROADPHASE_HPP__
+
+#include <vector>
+#include <utility>
+#include <cstdint>
+
+#include "Vec2.hpp"
+#include "CollisionFilter.hpp"
+
+class Broadphase {
+
+    // The interface of the broadphase collision detection of the discs.
+    //
+    // findPairs() is called once per step with the centers and the radii of
+    // all the discs, and returns the pairs (i, j) of the discs whose bounding
+    // boxes enlarged by the margin overlap, i.e.,
+    //
+    //   |c_i - c_j| <= r_i + r_j + margin in both x and y.
+    //
+    // The pairs have i < j, and are sorted by i and then j. An implementation
+    // may keep its state between the calls for the same discs.
+    //
+    // If the filter is set, the pairs it rejects are not returned.
+
+public:
+
+    Broadphase()
+        :m_filter{ nullptr }
+    {
+    }
+
+    virtual ~Broadphase()
+    {
+    }
+
+    // The filter must be sized to the discs given to findPairs().
+    virtual void setFilter( const CollisionFilter* filter )
+    {
+        m_filter = filter;
+    }
+
+    virtual void findPairs(
+        const std::vector< Vec2 >&                    centers,
+        const std::vector< float >&                   radii,
+        const float                                   margin,
+        std::vector< std::pair< int32_t, int32_t > >& pairs
+    ) = 0;
+
+protected:
+
+    bool accepts( const int32_t i, const int32_t j ) const
+    {
+        return m_filter == nullptr || m_filter->shouldCollide( i, j );
+    }
+
+    const CollisionFilter* m_filter;
+};
+
+#endif /*__BROADPHASE_HPP__*/
@@ -0,0 +1,105 @@
+#ifndef __COLLISION_FILTER_HPP__
+#define __COLLISION_FILTER_HPP__
+
+#include <vector>
+#include <unordered_set>
+#include <cstdint>
+
+class CollisionFilter {
+
+    // Decides whether two discs, given by their indices, can collide, in O(1).
+    //
+    // Each disc has the category bits it belongs to and the mask bits of the
+    // categories it collides with. Two discs can collide if each of them is in
+    // the mask of the other, and the pair is not in the exclusion set, e.g.,
+    // the pairs of the discs linked with the bilateral constraints.
+    //
+    // The version is incremented on each change, so that a broadphase that
+    // keeps the pairs over the steps can see that they are stale.
+
+public:
+
+    static constexpr uint32_t DEFAULT_CATEGORY = 0x00000001;
+    static constexpr uint32_t ALL_CATEGORIES   = 0xFFFFFFFF;
+
+    CollisionFilter()
+        :m_version{ 0 }
+    {
+    }
+
+    ~CollisionFilter()
+    {
+    }
+
+    // The new discs are in DEFAULT_CATEGORY and collide with all the categories.
+    void resize( const int32_t num_discs )
+    {
+        if ( num_discs == (int32_t)m_categories.size() ) {
+            return;
+        }
+
+        m_categories.resize( num_discs, DEFAULT_CATEGORY );
+        m_masks.resize( num_discs, ALL_CATEGORIES );
+        m_version++;
+    }
+
+    void setCategoryAndMask( const int32_t i, const uint32_t category, const uint32_t mask )
+    {
+        if ( m_categories[ i ] == category && m_masks[ i ] == mask ) {
+            return;
+        }
+
+        m_categories[ i ] = category;
+        m_masks[ i ]      = mask;
+        m_version++;
+    }
+
+    void exclude( const int32_t i, const int32_t j )
+    {
+        if ( m_exclusions.insert( key( i, j ) ).second ) {
+            m_version++;
+        }
+    }
+
+    void clearExclusions()
+    {
+        if ( !m_exclusions.empty() ) {
+
+            m_exclusions.clear();
+            m_version++;
+        }
+    }
+
+    bool shouldCollide( const int32_t i, const int32_t j ) const
+    {
+        if (    ( m_categories[ i ] & m_masks[ j ] ) == 0
+             || ( m_categories[ j ] & m_masks[ i ] ) == 0
+        ) {
+            return false;
+        }
+
+        return m_exclusions.empty() || m_exclusions.find( key( i, j ) ) == m_exclusions.end();
+    }
+
+    uint64_t version() const
+    {
+        return m_version;
+    }
+
+private:
+
+    static uint64_t key( const int32_t i, const int32_t j )
+    {
+        const auto lo = ( i < j ) ? i : j;
+        const auto hi = ( i < j ) ? j : i;
+
+        return ( (uint64_t)(uint32_t)lo << 32 ) | (uint64_t)(uint32_t)hi;
+    }
+
+    std::vector< uint32_t >        m_categories;
+    std::vector< uint32_t >        m_masks;
+    std::unordered_set< uint64_t > m_exclusions;
+    uint64_t                       m_version;
+};
+
+#endif /*__COLLISION_FILTER_HPP__*/
@@ -0,0 +1,289 @@
+#ifndef __CONSTRAINTS_RECORDER_HPP__
+#define __CONSTRAINTS_RECORDER_HPP__
+
+#include <vector>
+#include <memory>
+#include <string>
+#include <fstream>
+#include <iomanip>
+#include <unordered_map>
+#include <algorithm>
+#include <cmath>
+
+#include "RigidBody.hpp"
+#include "VelocityConstraint.hpp"
+#include "ConstraintsSolver.hpp"
+
+class ConstraintsRecorder {
+
+    // Records the input of ConstraintsSolver::run() frame by frame, i.e., the
+    // constraints with the lambdas for the warm starting, and the masses, the
+    // velocities and the forces of their bodies, so that the frames can be
+    // replayed offline by ConstraintsSolverTuner.
+    //
+    // The frames are saved as text, one line per frame header, body and constraint.
+    //
+    //   frame <delta_t> <num bodies> <num constraints>
+    //   b <mass> <vel x> <vel y> <force x> <force y>
+    //   c <type> <body 0> <body 1> <n0 x> <n0 y> <n1 x> <n1 y> <b> <lambda> <feature id>
+    //
+    // The body indices are within the frame, and -1 for none.
+
+public:
+
+    struct Frame {
+
+        float                                       m_delta_t;
+        std::vector< std::unique_ptr< RigidBody > > m_bodies;
+        std::vector< VelocityConstraint >           m_constraints;
+        std::vector< float >                        m_initial_lambdas;
+    };
+
+    ConstraintsRecorder()
+    {
+    }
+
+    ~ConstraintsRecorder()
+    {
+    }
+
+    void clear()
+    {
+        m_frames.clear();
+    }
+
+    // Called just before ConstraintsSolver::run() with the same constraints.
+    void record( const std::vector< VelocityConstraint* >& constraints, const float delta_t )
+    {
+        m_frames.emplace_back();
+
+        auto& frame = m_frames.back();
+        frame.m_delta_t = delta_t;
+
+        std::unordered_map< RigidBody*, RigidBody* > copies;
+
+        auto copy = [ &frame, &copies ]( RigidBody* body ) -> RigidBody* {
+
+            if ( body == nullptr ) {
+                return nullptr;
+            }
+
+            auto& c = copies[ body ];
+
+            if ( c == nullptr ) {
+
+                frame.m_bodies.emplace_back( new RigidBody( body->m_mass ) );
+
+                c            = frame.m_bodies.back().get();
+                c->m_lin_vel = body->m_lin_vel;
+                c->m_force   = body->m_force;
+            }
+            return c;
+        };
+
+        for ( const auto* c : constraints ) {
+
+            frame.m_constraints.emplace_back(
+                c->m_type, copy( c->m_body_0 ), copy( c->m_body_1 ), c->m_n0, c->m_n1, c->m_b, c->m_feature_id
+            );
+            frame.m_initial_lambdas.push_back( c->m_lambda );
+        }
+    }
+
+    int32_t numFrames() const
+    {
+        return (int32_t)m_frames.size();
+    }
+
+    Frame& frame( const int32_t i )
+    {
+        return m_frames[ i ];
+    }
+
+    // Solves the frame again from the recorded lambdas. The solution is left
+    // in the constraints of the frame.
+    template<class T>
+    void replay( ConstraintsSolver<T>& solver, Frame& frame ) const
+    {
+        solver.reset();
+
+        for ( int32_t i = 0; i < (int32_t)frame.m_constraints.size(); i++ ) {
+
+            frame.m_constraints[ i ].m_lambda = frame.m_initial_lambdas[ i ];
+            solver.add( &frame.m_constraints[ i ] );
+        }
+
+        solver.run( frame.m_delta_t );
+    }
+
+    // The largest violation [m/s] of the velocity constraints without the
+    // constraint force mixing by the lambdas in the frame, i.e., |w| for the
+    // bilateral ones and the active contacts, and max( 0, -w ) for the others.
+    static float maxViolation( const Frame& frame )
+    {
+        std::unordered_map< const RigidBody*, Vec2 > vel;
+
+        for ( const auto& body : frame.m_bodies ) {
+
+            vel[ body.get() ] = body->m_lin_vel + body->m_force * frame.m_delta_t * body->m_mass_inv;
+        }
+
+        for ( const auto& c : frame.m_constraints ) {
+
+            if ( c.m_body_0 != nullptr ) {
+                vel[ c.m_body_0 ] += c.m_n0 * ( c.m_lambda * c.m_body_0->m_mass_inv );
+            }
+            if ( c.m_body_1 != nullptr ) {
+                vel[ c.m_body_1 ] += c.m_n1 * ( c.m_lambda * c.m_body_1->m_mass_inv );
+            }
+        }
+
+        float violation = 0.0f;
+
+        for ( const auto& c : frame.m_constraints ) {
+
+            float w = -1.0f * c.m_b;
+
+            if ( c.m_body_0 != nullptr ) {
+                w += c.m_n0.dot( vel[ c.m_body_0 ] );
+            }
+            if ( c.m_body_1 != nullptr ) {
+                w += c.m_n1.dot( vel[ c.m_body_1 ] );
+            }
+
+            if ( c.m_type == VelocityConstraint::Bilateral || c.m_lambda > 0.0f ) {
+                violation = std::max( violation, std::abs( w ) );
+            }
+            else {
+                violation = std::max( violation, -1.0f * w );
+            }
+        }
+        return violation;
+    }
+
+    bool save( const std::string& path ) const
+    {
+        std::ofstream out( path );
+        if ( !out ) {
+            return false;
+        }
+
+        out << std::setprecision( 9 );
+
+        for ( const auto& frame : m_frames ) {
+
+            std::unordered_map< const RigidBody*, int32_t > indices;
+
+            out << "frame " << frame.m_delta_t << " " << frame.m_bodies.size() << " " << frame.m_constraints.size() << "\n";
+
+            for ( int32_t i = 0; i < (int32_t)frame.m_bodies.size(); i++ ) {
+
+                const auto& body = frame.m_bodies[ i ];
+
+                indices[ body.get() ] = i;
+
+                out << "b " << body->m_mass
+                    << " "  << body->m_lin_vel.x << " " << body->m_lin_vel.y
+                    << " "  << body->m_force.x   << " " << body->m_force.y << "\n";
+            }
+
+            for ( int32_t i = 0; i < (int32_t)frame.m_constraints.size(); i++ ) {
+
+                const auto& c = frame.m_constraints[ i ];
+
+                out << "c " << (int32_t)c.m_type
+                    << " "  << ( ( c.m_body_0 != nullptr ) ? indices[ c.m_body_0 ] : -1 )
+                    << " "  << ( ( c.m_body_1 != nullptr ) ? indices[ c.m_body_1 ] : -1 )
+                    << " "  << c.m_n0.x << " " << c.m_n0.y
+                    << " "  << c.m_n1.x << " " << c.m_n1.y
+                    << " "  << c.m_b
+                    << " "  << frame.m_initial_lambdas[ i ]
+                    << " "  << c.m_feature_id << "\n";
+            }
+        }
+        return (bool)out;
+    }
+
+    // Appends the frames in the file. Returns false if the file can not be read or is malformed.
+    bool load( const std::string& path )
+    {
+        std::ifstream in( path );
+        if ( !in ) {
+            return false;
+        }
+
+        std::string tag;
+
+        while ( in >> tag ) {
+
+            size_t num_bodies;
+            size_t num_constraints;
+
+            m_frames.emplace_back();
+            auto& frame = m_frames.back();
+
+            if ( tag != "frame" || !( in >> frame.m_delta_t >> num_bodies >> num_constraints ) ) {
+                m_frames.pop_back();
+                return false;
+            }
+
+            for ( size_t i = 0; i < num_bodies; i++ ) {
+
+                float mass;
+                Vec2  vel;
+                Vec2  force;
+
+                if ( !( in >> tag >> mass >> vel.x >> vel.y >> force.x >> force.y ) || tag != "b" ) {
+                    m_frames.pop_back();
+                    return false;
+                }
+
+                frame.m_bodies.emplace_back( new RigidBody( mass ) );
+                frame.m_bodies.back()->m_lin_vel = vel;
+                frame.m_bodies.back()->m_force   = force;
+            }
+
+            frame.m_constraints.reserve( num_constraints );
+
+            for ( size_t i = 0; i < num_constraints; i++ ) {
+
+                int32_t type;
+                int32_t b0;
+                int32_t b1;
+                Vec2    n0;
+                Vec2    n1;
+                float   b;
+                float   lambda;
+                int32_t feature_id;
+
+                if (    !( in >> tag >> type >> b0 >> b1 >> n0.x >> n0.y >> n1.x >> n1.y >> b >> lambda >> feature_id )
+                     || tag != "c"
+                     || ( type != VelocityConstraint::Unilateral && type != VelocityConstraint::Bilateral )
+                     || b0 < -1 || b0 >= (int32_t)num_bodies
+                     || b1 < -1 || b1 >= (int32_t)num_bodies
+                ) {
+                    m_frames.pop_back();
+                    return false;
+                }
+
+                frame.m_constraints.emplace_back(
+                    (VelocityConstraint::Type)type,
+                    ( b0 >= 0 ) ? frame.m_bodies[ b0 ].get() : nullptr,
+                    ( b1 >= 0 ) ? frame.m_bodies[ b1 ].get() : nullptr,
+                    n0,
+                    n1,
+                    b,
+                    feature_id
+                );
+                frame.m_initial_lambdas.push_back( lambda );
+            }
+        }
+        return true;
+    }
+
+private:
+
+    std::vector< Frame > m_frames;
+};
+
+#endif /*__CONSTRAINTS_RECORDER_HPP__*/
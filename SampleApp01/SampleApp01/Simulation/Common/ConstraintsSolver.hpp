@@ -2,20 +2,117 @@
 #define __CONSTRAINTS_SOLVER_HPP__
 
 #include <vector>
+#include <array>
 #include <map>
+#include <unordered_map>
+#include <memory>
+#include <string>
+#include <functional>
+#include <ostream>
+#include <algorithm>
 
 #include "VelocityConstraint.hpp"
 #include "MLCPSolverVanillaPGS.hpp"
+#include "SequentialImpulseSolver.hpp"
+#include "MLCPSolverProjectedJacobi.hpp"
+#include "MLCPSolverPivoting.hpp"
+#include "MLCPSolverAPGD.hpp"
+#include "MLCPSolverMultilevel.hpp"
+#include "MLCPSolverMixedPrecision.hpp"
+#include "MLCPSolverFixed.hpp"
+#include "MLCPSolverBatched.hpp"
+#include "MLCPBackend.hpp"
+#include "ThreadPool.hpp"
 
+template<class T>
 class ConstraintsSolver {
 
+    // The constraints are split into islands, i.e., the groups of the constraints
+    // connected through the bodies, and each island is solved as an independent MLCP.
+    // The islands are solved concurrently on the thread pool, largest first.
+    // The islands larger than the parallel island threshold are solved one by one
+    // before the others with the colored multithreaded sweep of the PGS.
+    //
+    // The PGS backend solves the islands of up to 16 constraints with
+    // MLCPSolverFixed of the smallest size that fits, unless the options that
+    // only MLCPSolverVanillaPGS has are enabled. In float, such islands with no
+    // direct rows are grouped by the size into the batches of 8, and each batch
+    // is solved with MLCPSolverBatched, one island per SIMD lane.
+    //
+    // M and q are assembled and solved in T. With setMixedPrecision(true), the
+    // PGS backend solves in float and refines the solution against the
+    // residual in T. See MLCPSolverMixedPrecision.
+    //
+    // The backend is chosen per island at the beginning of each run(). With
+    // Automatic, it is chosen from the dimension, the estimated density of M,
+    // the number of the bilateral rows, and the backend and its iterations on
+    // the island of the same first body in the last frame. See selectBackend().
+    // The other solvers can be plugged in with registerBackend(). The choices
+    // are kept in selections(), and also written to the selection log if set.
+
 public:
 
-    ConstraintsSolver()
-        :m_mlcp{ 1.0e-8 /* epsilon */, 1000 /* max iter */, 5 /* error stagnation */ }
+    typedef enum _Backend {
+        ProjectedGaussSeidel,
+        SequentialImpulse,
+        ProjectedJacobi,
+        Pivoting,
+        AcceleratedProjectedGradient,
+        Multilevel,
+        Automatic,
+        FirstRegistered,
+        LastRegistered = FirstRegistered + 15
+    } Backend;
+
+    typedef std::function< std::unique_ptr< MLCPBackend<T> >() > BackendFactory;
+
+    // The choice for an island in the last run().
+    struct Selection {
+
+        int32_t m_dim;
+        int32_t m_dim_bi;
+        int32_t m_nnz;               // estimated from the bodies shared by the rows.
+        // The backend that solved the island in the last frame, its iterations,
+        // i.e., the sweeps, the pivots or the cycles, or -1 if unknown, and
+        // whether it converged.
+        Backend m_recent_backend;
+        int32_t m_recent_iterations;
+        bool    m_recent_converged;
+        Backend m_backend;
+        int32_t m_iterations;
+    };
+
+    static constexpr int32_t MAX_NUM_COLORS = 64;
+
+    // Automatic
+    static constexpr int32_t AUTO_SMALL_DIM      = 16;
+    static constexpr int32_t AUTO_MULTILEVEL_DIM = 256;
+    static constexpr double  AUTO_DENSE_RATIO    = 0.25;
+
+    ConstraintsSolver( const int32_t num_workers = ThreadPool::defaultNumWorkers() )
+        :m_policy{ 1.0e-8 /* epsilon */, 1000 /* max iter */, 5 /* error stagnation */ }
         ,m_cfm_sigma{ 1.0e-6 }
         ,m_cfm_gamma{ 0.999 }
+        ,m_inner_policy{ 0.0f /* epsilon */, 1000 /* max iter */, 5 /* error stagnation */ }
+        ,m_storage{ MLCPSolverVanillaPGS<T>::Sparse }
+        ,m_backend{ ProjectedGaussSeidel }
+        ,m_direct_bilateral{ true }
+        ,m_nncg{ false }
+        ,m_pgs_relaxation{ 1.0 }
+        ,m_adaptive_pgs_relaxation{ false }
+        ,m_mixed_precision{ false }
+        ,m_max_num_refinements{ MLCPSolverMixedPrecision<T>::DEFAULT_MAX_NUM_REFINEMENTS }
+        ,m_jacobi_relaxation{ 1.6 }
+        ,m_pivoting_max_dim{ 64 }
+        ,m_parallel_island_threshold{ 1024 }
+        ,m_batch_small_islands{ true }
+        ,m_num_islands{ 0 }
+        ,m_num_iterations{ 0 }
+        ,m_selection_log{ nullptr }
+        ,m_num_frames{ 0 }
+        ,m_thread_pool{ num_workers }
     {
+        m_inner_policy.setRelativeTolerance( 1.0e-3f );
     }
 
     ~ConstraintsSolver()
@@ -28,6 +125,7 @@ public:
         m_bilateral.clear();
     }
 
+    // c->m_lambda is used as the initial value for the solver (warm starting).
     void add( VelocityConstraint* c )
     {
         if ( c->m_type == VelocityConstraint::Unilateral ) {
@@ -39,113 +137,1214 @@ public:
         }
     }
 
-    void run( const float delta_t )
+    void setStorage( const typename MLCPSolverVanillaPGS<T>::StorageType storage )
+    {
+        m_storage = storage;
+    }
+
+    void setBackend( const Backend backend )
+    {
+        m_backend = backend;
+    }
+
+    // Adds a backend that can be given to setBackend(). The factory is called
+    // once for each island solver that uses it, possibly from the worker threads.
+    // Returns ProjectedGaussSeidel if no more backends can be registered.
+    Backend registerBackend( const std::string& name, const BackendFactory& factory )
+    {
+        const auto backend = FirstRegistered + (int32_t)m_registered_factories.size();
+
+        if ( backend > LastRegistered ) {
+            return ProjectedGaussSeidel;
+        }
+
+        m_registered_names.push_back( name );
+        m_registered_factories.push_back( factory );
+
+        return (Backend)backend;
+    }
+
+    std::string backendName( const Backend backend ) const
+    {
+        static const char* names[] = {
+            "pgs", "si", "jacobi", "pivoting", "apgd", "multilevel", "auto"
+        };
+
+        if ( backend >= FirstRegistered ) {
+
+            const auto i = (size_t)( backend - FirstRegistered );
+
+            return ( i < m_registered_names.size() ) ? m_registered_names[ i ] : "unknown";
+        }
+
+        if ( backend < ProjectedGaussSeidel ) {
+            return "unknown";
+        }
+        return names[ backend ];
+    }
+
+    // One line per island is written after each run(). nullptr to disable.
+    void setSelectionLog( std::ostream* log )
+    {
+        m_selection_log = log;
+    }
+
+    // Indexed in the decreasing order of the dimensions of the islands.
+    const std::vector< Selection >& selections() const
+    {
+        return m_selections;
+    }
+
+    // If true, the PGS solves the bilateral constraints of each island directly
+    // with the sparse LDL^T in each iteration, and only the unilateral ones iteratively.
+    void setDirectBilateral( const bool direct )
+    {
+        m_direct_bilateral = direct;
+    }
+
+    // Over-relaxation factor of the PGS backend.
+    void setPGSRelaxation( const T omega )
+    {
+        m_pgs_relaxation = omega;
+    }
+
+    // If true, the PGS backend tunes the over-relaxation factor from the error history.
+    void setAdaptivePGSRelaxation( const bool adaptive )
+    {
+        m_adaptive_pgs_relaxation = adaptive;
+    }
+
+    // If true, the PGS backend solves in float, and refines the solution in T up to
+    // max_num_refinements times. The colored multithreaded sweep is not used.
+    void setMixedPrecision( const bool mixed, const int32_t max_num_refinements = MLCPSolverMixedPrecision<T>::DEFAULT_MAX_NUM_REFINEMENTS )
+    {
+        m_mixed_precision     = mixed;
+        m_max_num_refinements = max_num_refinements;
+    }
+
+    // If true, the PGS sweeps are accelerated with the nonsmooth nonlinear conjugate gradient.
+    void setNNCG( const bool nncg )
+    {
+        m_nncg = nncg;
+    }
+
+    // The Pivoting backend solves the islands up to this dimension exactly,
+    // and the larger ones with the PGS.
+    void setPivotingMaxDim( const int32_t dim )
+    {
+        m_pivoting_max_dim = dim;
+    }
+
+    // Over-relaxation factor of the ProjectedJacobi backend.
+    void setJacobiRelaxation( const T omega )
+    {
+        m_jacobi_relaxation = omega;
+    }
+
+    void setParallelIslandThreshold( const int32_t dim )
+    {
+        m_parallel_island_threshold = dim;
+    }
+
+    // The constraint force mixing. sigma is added to the diagonal of M,
+    // and q is scaled by gamma.
+    void setCFM( const T sigma, const T gamma )
+    {
+        m_cfm_sigma = sigma;
+        m_cfm_gamma = gamma;
+    }
+
+    // If true, the small islands are solved in the batches. See above.
+    void setBatchSmallIslands( const bool batch )
+    {
+        m_batch_small_islands = batch;
+    }
+
+    // The termination policy applied to all the backends.
+    MLCPConvergencePolicy<T>& convergencePolicy()
+    {
+        return m_policy;
+    }
+
+    // The policy of each float solve in the mixed precision. The policy above
+    // applies to the refinements. The relative tolerance is 1e-3 by default.
+    MLCPConvergencePolicy<float>& innerConvergencePolicy()
+    {
+        return m_inner_policy;
+    }
+
+    void run( const T delta_t )
+    {
+        indexConstraints();
+
+        findIslands();
+
+        selectBackends();
+
+        while ( (int32_t)m_island_solvers.size() < m_num_islands ) {
+
+            m_island_solvers.emplace_back( new IslandSolver{} );
+        }
+
+        int32_t num_large = 0;
+
+        if (    m_storage == MLCPSolverVanillaPGS<T>::Sparse
+             && !m_mixed_precision
+             && m_thread_pool.numThreads() > 1
+        ) {
+            while (    num_large < m_num_islands
+                    && m_selections[ num_large ].m_backend == ProjectedGaussSeidel
+                    && m_selections[ num_large ].m_dim >= m_parallel_island_threshold
+            ) {
+                num_large++;
+            }
+        }
+
+        for ( int32_t k = 0; k < num_large; k++ ) {
+
+            solveIsland( k, delta_t, true );
+        }
+
+        formBatches( num_large );
+
+        while ( m_batch_solvers.size() < m_batches.size() ) {
+
+            m_batch_solvers.emplace_back( new BatchSolver{} );
+        }
+
+        const auto num_unbatched = (int32_t)m_unbatched.size();
+
+        m_thread_pool.run(
+            num_unbatched + (int32_t)m_batches.size(),
+            [this, num_unbatched, delta_t]( const int32_t k ) {
+
+                if ( k < num_unbatched ) {
+                    solveIsland( m_unbatched[ k ], delta_t, false );
+                }
+                else {
+                    solveBatch( k - num_unbatched, delta_t );
+                }
+            }
+        );
+
+        m_num_iterations = 0;
+
+        for ( int32_t k = 0; k < m_num_islands; k++ ) {
+
+            m_num_iterations += m_island_solvers[ k ]->m_iterations;
+        }
+
+        recordSelections();
+        m_num_frames++;
+    }
+
+    int32_t numIslands() const
+    {
+        return m_num_islands;
+    }
+
+    // The total number of the iterations (the pivots for Pivoting) over the islands in the last run.
+    int32_t numIterations() const
+    {
+        return m_num_iterations;
+    }
+
+private:
+
+    // A group of the constraints connected through the bodies.
+    struct Island {
+
+        std::vector< int32_t > m_constraints; // bilateral first, then unilateral.
+        std::vector< int32_t > m_bodies;
+        int32_t                m_dim_bi;
+    };
+
+    // The solvers and the work area for an island. They are reused across the frames.
+    // The convergence policy is assigned before each solve.
+    struct RecentSolve {
+
+        Backend m_backend;
+        int32_t m_iterations;
+        bool    m_converged;
+    };
+
+    struct IslandSolver {
+
+        IslandSolver()
+            :m_mlcp       { 0.0, 0, 0 }
+            ,m_si         { 0.0, 0, 0 }
+            ,m_jacobi     { 0.0, 0, 0 }
+            ,m_apgd       { 0.0, 0, 0 }
+            ,m_multilevel { 0.0, 0, 0 }
+            ,m_mixed      { 0.0, 0, 0 }
+            ,m_fixed_4    { 0.0, 0, 0 }
+            ,m_fixed_8    { 0.0, 0, 0 }
+            ,m_fixed_16   { 0.0, 0, 0 }
+            ,m_iterations { 0 }
+            ,m_solved_by  { ProjectedGaussSeidel }
+            ,m_converged  { true }
+        {
+        }
+
+        MLCPSolverVanillaPGS<T>        m_mlcp;
+        SequentialImpulseSolver<T>     m_si;
+        MLCPSolverProjectedJacobi<T>   m_jacobi;
+        MLCPSolverPivoting<T>          m_pivoting;
+        MLCPSolverAPGD<T>              m_apgd;
+        MLCPSolverMultilevel<T>        m_multilevel;
+        MLCPSolverMixedPrecision<T>    m_mixed;
+        MLCPSolverFixed<T, 4>          m_fixed_4;
+        MLCPSolverFixed<T, 8>          m_fixed_8;
+        MLCPSolverFixed<T, 16>         m_fixed_16;
+        int32_t                        m_iterations;
+
+        // differs from the selection if Pivoting has fallen back to the PGS.
+        Backend                        m_solved_by;
+        bool                           m_converged;
+
+        // created on the first use, indexed by the backend - FirstRegistered.
+        std::vector< std::unique_ptr< MLCPBackend<T> > >
+                                       m_registered;
+
+        // work area to accumulate a row of M.
+        std::vector< int32_t >         m_row_marker;
+        std::vector< int32_t >         m_row_cols;
+        std::vector< T >               m_row_vals;
+
+        // work area for coloring.
+        std::vector< uint64_t >        m_body_color_masks;
+        std::vector< int32_t >         m_row_colors;
+        std::vector< int32_t >         m_rows_by_color;
+        std::vector< int32_t >         m_color_begin;
+    };
+
+    // Up to 8 small islands of similar sizes solved together. m_islands are the indices to m_island_order.
+    struct Batch {
+
+        int32_t                  m_max_dim;
+        int32_t                  m_dim;
+        int32_t                  m_num_islands;
+        std::array< int32_t, 8 > m_islands;
+    };
+
+    static constexpr std::array< int32_t, 3 > BATCH_MAX_DIMS{ 4, 8, 16 };
+
+    struct BatchSolver {
+
+        BatchSolver()
+            :m_batched_4  { 0.0f, 0, 0 }
+            ,m_batched_8  { 0.0f, 0, 0 }
+            ,m_batched_16 { 0.0f, 0, 0 }
+        {
+        }
+
+        MLCPSolverBatched< 4 >  m_batched_4;
+        MLCPSolverBatched< 8 >  m_batched_8;
+        MLCPSolverBatched< 16 > m_batched_16;
+    };
+
+    // The islands from first on are either batched or left to solveIsland().
+    // The islands are in the decreasing order of the dimensions, and the batches
+    // of each size class are filled in that order.
+    void formBatches( const int32_t first )
+    {
+        m_unbatched.clear();
+        m_batches.clear();
+
+        const bool batching =    std::is_same< float, T >::value
+                              && m_batch_small_islands
+                              && !m_mixed_precision
+                              && !m_nncg
+                              && !m_adaptive_pgs_relaxation;
+
+        std::array< int32_t, 3 > open_batches{ -1, -1, -1 };
+
+        for ( int32_t k = first; k < m_num_islands; k++ ) {
+
+            const auto& island = m_islands[ m_island_order[ k ] ];
+            const auto  dim    = (int32_t)island.m_constraints.size();
+
+            if (    !batching
+                 || m_selections[ k ].m_backend != ProjectedGaussSeidel
+                 || dim > 16
+                 || ( m_direct_bilateral && island.m_dim_bi > 0 )
+            ) {
+
+                m_unbatched.push_back( k );
+                continue;
+            }
+
+            const auto size_class = ( dim <= 4 ) ? 0 : ( ( dim <= 8 ) ? 1 : 2 );
+            auto&      open       = open_batches[ size_class ];
+
+            if ( open < 0 || m_batches[ open ].m_num_islands == 8 ) {
+
+                open = (int32_t)m_batches.size();
+                m_batches.push_back( Batch{ BATCH_MAX_DIMS[ size_class ], dim, 0, {} } );
+            }
+
+            auto& batch = m_batches[ open ];
+            batch.m_islands[ batch.m_num_islands++ ] = k;
+        }
+    }
+
+    void solveBatch( const int32_t b, const T delta_t )
+    {
+        if constexpr ( std::is_same< float, T >::value ) {
+
+            auto& batch  = m_batches[ b ];
+            auto& solver = *m_batch_solvers[ b ];
+
+            if ( batch.m_max_dim == 4 ) {
+                solveBatch( batch, solver.m_batched_4, delta_t );
+            }
+            else if ( batch.m_max_dim == 8 ) {
+                solveBatch( batch, solver.m_batched_8, delta_t );
+            }
+            else {
+                solveBatch( batch, solver.m_batched_16, delta_t );
+            }
+        }
+    }
+
+    template<class BATCHED>
+    void solveBatch( const Batch& batch, BATCHED& batched, const T delta_t )
+    {
+        batched.convergencePolicy() = m_policy;
+        batched.setRelaxation( m_pgs_relaxation );
+        batched.prepare( batch.m_num_islands, batch.m_dim );
+
+        for ( int32_t l = 0; l < batch.m_num_islands; l++ ) {
+
+            const auto k    = batch.m_islands[ l ];
+            auto       lane = batched.lane( l );
+
+            constructMandQ( m_islands[ m_island_order[ k ] ], *m_island_solvers[ k ], lane, delta_t );
+        }
+
+        batched.run();
+
+        for ( int32_t l = 0; l < batch.m_num_islands; l++ ) {
+
+            const auto k = batch.m_islands[ l ];
+
+            assignLambdas( m_islands[ m_island_order[ k ] ], batched.lane( l ) );
+            m_island_solvers[ k ]->m_iterations = batched.getIterations( l );
+            m_island_solvers[ k ]->m_solved_by  = ProjectedGaussSeidel;
+            m_island_solvers[ k ]->m_converged  = true;
+        }
+    }
+
+    void solveIsland( const int32_t k, const T delta_t, const bool colored )
+    {
+        const auto& island = m_islands[ m_island_order[ k ] ];
+        auto&       solver = *m_island_solvers[ k ];
+
+        const auto  backend = m_selections[ k ].m_backend;
+
+        solver.m_solved_by = backend;
+        solver.m_converged = true;
+
+        if ( backend >= FirstRegistered ) {
+
+            solveIslandRegistered( island, solver, backend - FirstRegistered, delta_t );
+            return;
+        }
+
+        if ( backend == SequentialImpulse ) {
+
+            solver.m_si.convergencePolicy() = m_policy;
+            solver.m_si.prepare( (int32_t)island.m_bodies.size(), (int32_t)island.m_constraints.size() );
+
+            constructSequentialImpulseRows( island, solver.m_si, delta_t );
+
+            solver.m_si.run();
+
+            assignLambdas( island, solver.m_si );
+            solver.m_iterations = solver.m_si.getIterations();
+            return;
+        }
+
+        if ( backend == ProjectedJacobi ) {
+
+            solver.m_jacobi.convergencePolicy() = m_policy;
+            solver.m_jacobi.setRelaxation( m_jacobi_relaxation );
+            solver.m_jacobi.prepare( (int32_t)island.m_constraints.size() );
+
+            constructMandQ( island, solver, solver.m_jacobi, delta_t );
+
+            solver.m_jacobi.run();
+
+            assignLambdas( island, solver.m_jacobi );
+            solver.m_iterations = solver.m_jacobi.getIterations();
+            return;
+        }
+
+        if ( backend == AcceleratedProjectedGradient ) {
+
+            solver.m_apgd.convergencePolicy() = m_policy;
+            solver.m_apgd.prepare( (int32_t)island.m_constraints.size() );
+
+            constructMandQ( island, solver, solver.m_apgd, delta_t );
+
+            solver.m_apgd.run();
+
+            assignLambdas( island, solver.m_apgd );
+            solver.m_iterations = solver.m_apgd.getIterations();
+            return;
+        }
+
+        if ( backend == Multilevel ) {
+
+            solver.m_multilevel.convergencePolicy() = m_policy;
+            solver.m_multilevel.prepare( (int32_t)island.m_constraints.size() );
+
+            constructMandQ( island, solver, solver.m_multilevel, delta_t );
+
+            solver.m_multilevel.run();
+
+            assignLambdas( island, solver.m_multilevel );
+            solver.m_iterations = solver.m_multilevel.getIterations();
+            solver.m_converged  = solver.m_multilevel.getStatus() == MLCPConvergencePolicy<T>::Converged;
+            return;
+        }
+
+        if ( backend == Pivoting && (int32_t)island.m_constraints.size() <= m_pivoting_max_dim ) {
+
+            solver.m_pivoting.prepare( (int32_t)island.m_constraints.size() );
+
+            constructMandQ( island, solver, solver.m_pivoting, delta_t );
+
+            solver.m_pivoting.run();
+
+            // falls back to the PGS if the pivots ran out.
+            if ( solver.m_pivoting.getStatus() == MLCPConvergencePolicy<T>::Converged ) {
+
+                assignLambdas( island, solver.m_pivoting );
+                solver.m_iterations = solver.m_pivoting.getIterations();
+                return;
+            }
+        }
+
+        if ( backend != ProjectedGaussSeidel ) {
+            solver.m_solved_by = ProjectedGaussSeidel;
+        }
+
+        const auto dim        = (int32_t)island.m_constraints.size();
+        const auto dim_direct = m_direct_bilateral ? island.m_dim_bi : 0;
+
+        if ( !m_mixed_precision && !m_nncg && !m_adaptive_pgs_relaxation && !colored ) {
+
+            if ( dim <= 4 ) {
+                solveIslandFixed( island, solver, solver.m_fixed_4, dim_direct, delta_t );
+                return;
+            }
+            if ( dim <= 8 ) {
+                solveIslandFixed( island, solver, solver.m_fixed_8, dim_direct, delta_t );
+                return;
+            }
+            if ( dim <= 16 ) {
+                solveIslandFixed( island, solver, solver.m_fixed_16, dim_direct, delta_t );
+                return;
+            }
+        }
+
+        if ( m_mixed_precision ) {
+
+            solver.m_mixed.convergencePolicy()      = m_policy;
+            solver.m_mixed.innerConvergencePolicy() = m_inner_policy;
+            solver.m_mixed.setMaxNumRefinements( m_max_num_refinements );
+            solver.m_mixed.prepare( dim );
+
+            solver.m_mixed.setDirectRows( dim_direct );
+            solver.m_mixed.setNNCG( m_nncg );
+            solver.m_mixed.setRelaxation( m_pgs_relaxation );
+            solver.m_mixed.setAdaptiveRelaxation( m_adaptive_pgs_relaxation );
+
+            constructMandQ( island, solver, solver.m_mixed, delta_t );
+
+            solver.m_mixed.run();
+
+            assignLambdas( island, solver.m_mixed );
+            solver.m_iterations = solver.m_mixed.getIterations();
+            return;
+        }
+
+        solver.m_mlcp.convergencePolicy() = m_policy;
+        solver.m_mlcp.prepare( dim, m_storage );
+
+        solver.m_mlcp.setDirectRows( dim_direct );
+        solver.m_mlcp.setNNCG( m_nncg );
+        solver.m_mlcp.setRelaxation( m_pgs_relaxation );
+        solver.m_mlcp.setAdaptiveRelaxation( m_adaptive_pgs_relaxation );
+
+        constructMandQ( island, solver, solver.m_mlcp, delta_t );
+
+        if ( colored ) {
+
+            colorRows( island, solver, dim_direct );
+            solver.m_mlcp.setColoring( solver.m_rows_by_color, solver.m_color_begin, &m_thread_pool );
+        }
+
+        solver.m_mlcp.run();
+
+        assignLambdas( island, solver.m_mlcp );
+        solver.m_iterations = solver.m_mlcp.getIterations();
+    }
+
+    void solveIslandRegistered( const Island& island, IslandSolver& solver, const int32_t r, const T delta_t )
+    {
+        if ( (int32_t)solver.m_registered.size() <= r ) {
+            solver.m_registered.resize( r + 1 );
+        }
+
+        if ( !solver.m_registered[ r ] ) {
+            solver.m_registered[ r ] = m_registered_factories[ r ]();
+        }
+
+        auto& mlcp = *solver.m_registered[ r ];
+
+        mlcp.convergencePolicy() = m_policy;
+        mlcp.prepare( (int32_t)island.m_constraints.size(), island.m_dim_bi );
+
+        constructMandQ( island, solver, mlcp, delta_t );
+
+        mlcp.run();
+
+        assignLambdas( island, mlcp );
+        solver.m_iterations = mlcp.getIterations();
+    }
+
+    template<class FIXED>
+    void solveIslandFixed(
+        const Island& island,
+        IslandSolver& solver,
+        FIXED&        fixed,
+        const int32_t dim_direct,
+        const T       delta_t
+    ) {
+        fixed.convergencePolicy() = m_policy;
+        fixed.prepare( (int32_t)island.m_constraints.size() );
+
+        fixed.setDirectRows( dim_direct );
+        fixed.setRelaxation( m_pgs_relaxation );
+
+        constructMandQ( island, solver, fixed, delta_t );
+
+        fixed.run();
+
+        assignLambdas( island, fixed );
+        solver.m_iterations = fixed.getIterations();
+    }
+
+    // Builds the body-to-constraint adjacency.
+    // The constraints are ordered bilateral first, and the bodies are indexed
+    // in the order of their first appearance to keep the assembly deterministic.
+    void indexConstraints()
     {
-        const auto dim_bi  = (int32_t)m_bilateral.size();
-        const auto dim_uni = (int32_t)m_unilateral.size();
+        m_constraints.clear();
+        m_constraints.insert( m_constraints.end(), m_bilateral.begin(),  m_bilateral.end()  );
+        m_constraints.insert( m_constraints.end(), m_unilateral.begin(), m_unilateral.end() );
+
+        const auto dim = (int32_t)m_constraints.size();
+
+        m_body_indices.clear();
+        m_bodies.clear();
+        m_body_index_0.resize( dim );
+        m_body_index_1.resize( dim );
 
-        m_mlcp.prepare( dim_bi + dim_uni );
+        for ( int32_t i = 0; i < dim; i++ ) {
 
-        constructMandQ( delta_t );
+            m_body_index_0[ i ] = findOrAddBody( m_constraints[ i ]->m_body_0 );
+            m_body_index_1[ i ] = findOrAddBody( m_constraints[ i ]->m_body_1 );
+        }
+
+        const auto num_bodies = (int32_t)m_bodies.size();
+
+        m_body_constraints_begin.assign( num_bodies + 1, 0 );
+
+        for ( int32_t i = 0; i < dim; i++ ) {
+
+            if ( m_body_index_0[ i ] >= 0 ) {
+                m_body_constraints_begin[ m_body_index_0[ i ] + 1 ]++;
+            }
+            if ( m_body_index_1[ i ] >= 0 ) {
+                m_body_constraints_begin[ m_body_index_1[ i ] + 1 ]++;
+            }
+        }
+
+        for ( int32_t b = 0; b < num_bodies; b++ ) {
+
+            m_body_constraints_begin[ b + 1 ] += m_body_constraints_begin[ b ];
+        }
 
-        m_mlcp.run();
+        m_body_constraints.resize( m_body_constraints_begin[ num_bodies ] );
+        m_body_constraints_fill.assign( m_body_constraints_begin.begin(), m_body_constraints_begin.end() - 1 );
 
-        assignLambdas();
+        for ( int32_t i = 0; i < dim; i++ ) {
+
+            if ( m_body_index_0[ i ] >= 0 ) {
+                m_body_constraints[ m_body_constraints_fill[ m_body_index_0[ i ] ]++ ] = i;
+            }
+            if ( m_body_index_1[ i ] >= 0 ) {
+                m_body_constraints[ m_body_constraints_fill[ m_body_index_1[ i ] ]++ ] = i;
+            }
+        }
     }
-    
-    void constructMandQ( const float delta_t )
+
+    // Fills m_selections in the order of m_island_order.
+    void selectBackends()
     {
-        const auto dim_bi  = m_bilateral.size();
-        const auto dim_uni = m_unilateral.size();
+        m_selections.resize( m_num_islands );
+
+        for ( int32_t k = 0; k < m_num_islands; k++ ) {
+
+            const auto& island    = m_islands[ m_island_order[ k ] ];
+            auto&       selection = m_selections[ k ];
 
-        for ( int i = 0; i < dim_bi + dim_uni; i++ ) {
+            selection.m_dim               = (int32_t)island.m_constraints.size();
+            selection.m_dim_bi            = island.m_dim_bi;
+            selection.m_nnz               = estimateNumNonzeros( island );
+            selection.m_recent_backend    = ProjectedGaussSeidel;
+            selection.m_recent_iterations = -1;
+            selection.m_recent_converged  = true;
+            selection.m_iterations        = 0;
 
-            auto& c_i = (i < dim_bi) ? m_bilateral[ i ] : m_unilateral[ i - dim_bi ];
+            const auto it = m_recent_solves.find( m_bodies[ island.m_bodies[ 0 ] ] );
+            if ( it != m_recent_solves.end() ) {
+                selection.m_recent_backend    = it->second.m_backend;
+                selection.m_recent_iterations = it->second.m_iterations;
+                selection.m_recent_converged  = it->second.m_converged;
+            }
+
+            selection.m_backend = selectBackend( selection );
+        }
+    }
 
-            for ( int j = i; j < dim_bi + dim_uni; j++ ) {
+    // - The small islands go to the PGS, i.e., MLCPSolverFixed or MLCPSolverBatched.
+    // - Pivoting or Multilevel is kept while it converges on the island, as
+    //   its iterations are not comparable with those of the PGS.
+    // - Pivoting for the dense ones, and for those on which the PGS spent
+    //   more than half of the iteration cap in the last frame.
+    // - Multilevel for the large ones on which the PGS spent many iterations
+    //   in the last frame, or with many bilateral rows (chains, ragdolls)
+    //   unless they are solved directly.
+    // - PGS otherwise.
+    Backend selectBackend( const Selection& s ) const
+    {
+        if ( m_backend != Automatic ) {
+            return m_backend;
+        }
 
-                float M_ij = 0.0f;
+        if ( s.m_dim <= AUTO_SMALL_DIM ) {
+            return ProjectedGaussSeidel;
+        }
 
-                auto& c_j = (j < dim_bi) ? m_bilateral[ j ] : m_unilateral[ j - dim_bi ];
+        const bool pivoting_fits   = s.m_dim <= m_pivoting_max_dim;
+        const bool multilevel_fits = s.m_dim >= AUTO_MULTILEVEL_DIM;
 
-                if ( c_i->m_body_0 != nullptr ) {
+        if ( s.m_recent_converged ) {
 
-                    if ( c_i->m_body_0 == c_j->m_body_0 ) {
+            if ( s.m_recent_backend == Pivoting && pivoting_fits ) {
+                return Pivoting;
+            }
+            if ( s.m_recent_backend == Multilevel && multilevel_fits ) {
+                return Multilevel;
+            }
+        }
 
-                        M_ij += ( c_i->m_n0.dot( c_j->m_n0 ) * c_i->m_body_0->m_mass_inv );
-                    }
-                    else if ( c_i->m_body_0 == c_j->m_body_1 ) {
+        const bool hard  =    s.m_recent_backend == ProjectedGaussSeidel
+                           && 2 * s.m_recent_iterations > m_policy.maxNumIterations();
+        const bool dense = s.m_nnz >= AUTO_DENSE_RATIO * s.m_dim * s.m_dim;
 
-                        M_ij += ( c_i->m_n0.dot( c_j->m_n1 ) * c_i->m_body_0->m_mass_inv );
-                    }
+        if ( pivoting_fits && ( dense || hard ) ) {
+            return Pivoting;
+        }
+
+        if ( multilevel_fits && ( hard || ( !m_direct_bilateral && 2 * s.m_dim_bi >= s.m_dim ) ) ) {
+            return Multilevel;
+        }
+
+        return ProjectedGaussSeidel;
+    }
+
+    // Each row i has a non-zero M_ij for each constraint j on its bodies,
+    // counting twice the pairs of the constraints on the same two bodies.
+    int32_t estimateNumNonzeros( const Island& island ) const
+    {
+        int32_t nnz = 0;
+
+        for ( const auto g : island.m_constraints ) {
+
+            for ( const auto b : { m_body_index_0[ g ], m_body_index_1[ g ] } ) {
+
+                if ( b >= 0 ) {
+                    nnz += m_body_constraints_begin[ b + 1 ] - m_body_constraints_begin[ b ];
                 }
+            }
+        }
+        return std::min( nnz, (int32_t)( island.m_constraints.size() * island.m_constraints.size() ) );
+    }
+
+    // Keeps the backends and their iterations for the next frame, and writes the log.
+    void recordSelections()
+    {
+        m_recent_solves.clear();
+
+        for ( int32_t k = 0; k < m_num_islands; k++ ) {
+
+            const auto& island    = m_islands[ m_island_order[ k ] ];
+            auto&       selection = m_selections[ k ];
+
+            selection.m_iterations = m_island_solvers[ k ]->m_iterations;
+
+            m_recent_solves[ m_bodies[ island.m_bodies[ 0 ] ] ] = RecentSolve{
+                m_island_solvers[ k ]->m_solved_by,
+                selection.m_iterations,
+                m_island_solvers[ k ]->m_converged
+            };
+
+            if ( m_selection_log != nullptr ) {
+
+                *m_selection_log << "frame "       << m_num_frames
+                                 << " island "     << k
+                                 << " dim "        << selection.m_dim
+                                 << " bi "         << selection.m_dim_bi
+                                 << " nnz "        << selection.m_nnz
+                                 << " recent "     << backendName( selection.m_recent_backend )
+                                 << " "            << selection.m_recent_iterations
+                                 << " backend "    << backendName( selection.m_backend )
+                                 << " iterations " << selection.m_iterations
+                                 << "\n";
+            }
+        }
+    }
 
-                if ( c_i->m_body_1 != nullptr ) {
+    // Union-find over the bodies connected by the constraints.
+    // The islands are ordered by their dimensions, largest first.
+    void findIslands()
+    {
+        const auto dim        = (int32_t)m_constraints.size();
+        const auto dim_bi     = (int32_t)m_bilateral.size();
+        const auto num_bodies = (int32_t)m_bodies.size();
 
-                    if ( c_i->m_body_1 == c_j->m_body_0 ) {
+        m_body_parent.resize( num_bodies );
+        for ( int32_t b = 0; b < num_bodies; b++ ) {
+            m_body_parent[ b ] = b;
+        }
+
+        for ( int32_t i = 0; i < dim; i++ ) {
 
-                        M_ij += ( c_i->m_n1.dot( c_j->m_n0 ) * c_i->m_body_1->m_mass_inv );
-                    }
-                    else if ( c_i->m_body_1 == c_j->m_body_1 ) {
+            if ( m_body_index_0[ i ] >= 0 && m_body_index_1[ i ] >= 0 ) {
 
-                        M_ij += ( c_i->m_n1.dot( c_j->m_n1 ) * c_i->m_body_1->m_mass_inv );
-                    }
+                uniteBodies( m_body_index_0[ i ], m_body_index_1[ i ] );
+            }
+        }
+
+        m_root_island.assign( num_bodies, -1 );
+        m_local_index.resize( dim );
+        m_num_islands = 0;
+
+        for ( int32_t i = 0; i < dim; i++ ) {
+
+            const auto b    = ( m_body_index_0[ i ] >= 0 ) ? m_body_index_0[ i ] : m_body_index_1[ i ];
+            const auto root = findRootBody( b );
+
+            if ( m_root_island[ root ] < 0 ) {
+
+                m_root_island[ root ] = m_num_islands++;
+
+                if ( (int32_t)m_islands.size() < m_num_islands ) {
+                    m_islands.emplace_back();
                 }
 
+                auto& island = m_islands[ m_num_islands - 1 ];
+                island.m_constraints.clear();
+                island.m_bodies.clear();
+                island.m_dim_bi = 0;
+            }
+
+            auto& island = m_islands[ m_root_island[ root ] ];
+
+            m_local_index[ i ] = (int32_t)island.m_constraints.size();
+            island.m_constraints.push_back( i );
+
+            if ( i < dim_bi ) {
+                island.m_dim_bi++;
+            }
+        }
+
+        m_local_body_index.resize( num_bodies );
+
+        for ( int32_t b = 0; b < num_bodies; b++ ) {
+
+            auto& island = m_islands[ m_root_island[ findRootBody( b ) ] ];
+
+            m_local_body_index[ b ] = (int32_t)island.m_bodies.size();
+            island.m_bodies.push_back( b );
+        }
+
+        m_island_order.resize( m_num_islands );
+        for ( int32_t k = 0; k < m_num_islands; k++ ) {
+            m_island_order[ k ] = k;
+        }
+
+        std::stable_sort(
+            m_island_order.begin(),
+            m_island_order.end(),
+            [this]( const int32_t a, const int32_t b ) {
+                return m_islands[ a ].m_constraints.size() > m_islands[ b ].m_constraints.size();
+            }
+        );
+    }
+
+    int32_t findRootBody( int32_t b )
+    {
+        while ( m_body_parent[ b ] != b ) {
+
+            m_body_parent[ b ] = m_body_parent[ m_body_parent[ b ] ];
+            b = m_body_parent[ b ];
+        }
+        return b;
+    }
+
+    void uniteBodies( const int32_t b0, const int32_t b1 )
+    {
+        const auto r0 = findRootBody( b0 );
+        const auto r1 = findRootBody( b1 );
+
+        if ( r0 != r1 ) {
+            m_body_parent[ std::max( r0, r1 ) ] = std::min( r0, r1 );
+        }
+    }
+
+    // Only the pairs of constraints that share a body are visited,
+    // and only the non-zero elements of M are set row by row.
+    template<class MLCP>
+    void constructMandQ( const Island& island, IslandSolver& work, MLCP& mlcp, const T delta_t )
+    {
+        const auto dim = (int32_t)island.m_constraints.size();
+
+        work.m_row_marker.assign( dim, -1 );
+        work.m_row_vals.resize( dim );
+
+        for ( int i = 0; i < dim; i++ ) {
+
+            const auto  g   = island.m_constraints[ i ];
+            const auto& c_i = m_constraints[ g ];
+
+            work.m_row_cols.clear();
+
+            accumulateRow( work, i, m_body_index_0[ g ], c_i->m_n0 );
+            accumulateRow( work, i, m_body_index_1[ g ], c_i->m_n1 );
+
+            for ( const auto j : work.m_row_cols ) {
+
                 if ( i == j ) {
-                    m_mlcp.setM( i, j, M_ij + m_cfm_sigma );
+                    mlcp.setM( i, j, work.m_row_vals[ j ] + m_cfm_sigma );
                 }
                 else {
-                    m_mlcp.setM( i, j, M_ij );
-                    m_mlcp.setM( j, i, M_ij );
+                    mlcp.setM( i, j, work.m_row_vals[ j ] );
                 }
             }
 
-            float q_i = -1.0f * c_i->m_b;
+            mlcp.setQ( i, calcQ( c_i, delta_t ) );
 
-            if ( c_i->m_body_0 != nullptr ) {
+            if ( i < island.m_dim_bi ) {
 
-                q_i += c_i->m_n0.dot( c_i->m_body_0->m_lin_vel + c_i->m_body_0->m_force * delta_t * c_i->m_body_0->m_mass_inv );
+                mlcp.setNoLimits( i );
+                mlcp.setInitialZ( i, c_i->m_lambda );
+            }
+            else {
+                mlcp.setUnilateralLimits( i );
+                mlcp.setInitialZ( i, std::max( (T)0.0, (T)c_i->m_lambda ) );
             }
+        }
+    }
+
+    // Greedy coloring of the rows such that no two rows of the same color share a body.
+    // The rows that do not fit in MAX_NUM_COLORS get a color each.
+    // The rows before first_row are not colored.
+    void colorRows( const Island& island, IslandSolver& work, const int32_t first_row )
+    {
+        const auto dim = (int32_t)island.m_constraints.size();
+
+        work.m_body_color_masks.assign( island.m_bodies.size(), 0 );
+        work.m_row_colors.resize( dim );
+        work.m_color_begin.assign( MAX_NUM_COLORS + 1, 0 );
+
+        int32_t num_overflows = 0;
+
+        for ( int32_t i = first_row; i < dim; i++ ) {
 
-            if ( c_i->m_body_1 != nullptr ) {
+            const auto g  = island.m_constraints[ i ];
+            const auto b0 = ( m_body_index_0[ g ] >= 0 ) ? m_local_body_index[ m_body_index_0[ g ] ] : -1;
+            const auto b1 = ( m_body_index_1[ g ] >= 0 ) ? m_local_body_index[ m_body_index_1[ g ] ] : -1;
 
-                q_i += c_i->m_n1.dot( c_i->m_body_1->m_lin_vel + c_i->m_body_1->m_force * delta_t * c_i->m_body_1->m_mass_inv );
+            uint64_t used = 0;
+            if ( b0 >= 0 ) {
+                used |= work.m_body_color_masks[ b0 ];
+            }
+            if ( b1 >= 0 ) {
+                used |= work.m_body_color_masks[ b1 ];
             }
 
-            q_i *= m_cfm_gamma;
-            m_mlcp.setQ( i, q_i );
+            int32_t color = 0;
+            while ( color < MAX_NUM_COLORS && ( ( used >> color ) & 1 ) != 0 ) {
+                color++;
+            }
 
-            if ( i < dim_bi ) {
+            if ( color < MAX_NUM_COLORS ) {
 
-                m_mlcp.setNoLimits( i );
+                if ( b0 >= 0 ) {
+                    work.m_body_color_masks[ b0 ] |= ( uint64_t(1) << color );
+                }
+                if ( b1 >= 0 ) {
+                    work.m_body_color_masks[ b1 ] |= ( uint64_t(1) << color );
+                }
+                work.m_color_begin[ color + 1 ]++;
+            }
+            else {
+                num_overflows++;
+            }
+
+            work.m_row_colors[ i ] = color;
+        }
+
+        for ( int32_t c = 0; c < MAX_NUM_COLORS; c++ ) {
+
+            work.m_color_begin[ c + 1 ] += work.m_color_begin[ c ];
+        }
+
+        work.m_rows_by_color.resize( dim - first_row );
+
+        auto next_overflow = work.m_color_begin[ MAX_NUM_COLORS ];
+
+        for ( int32_t i = first_row; i < dim; i++ ) {
+
+            const auto color = work.m_row_colors[ i ];
+
+            if ( color < MAX_NUM_COLORS ) {
+                work.m_rows_by_color[ work.m_color_begin[ color ]++ ] = i;
             }
             else {
-                m_mlcp.setUnilateralLimits( i );
+                work.m_rows_by_color[ next_overflow++ ] = i;
+            }
+        }
+
+        // m_color_begin[c] has been advanced to the beginning of c+1. Shift it back.
+        for ( int32_t c = MAX_NUM_COLORS; c > 0; c-- ) {
+
+            work.m_color_begin[ c ] = work.m_color_begin[ c - 1 ];
+        }
+        work.m_color_begin[ 0 ] = 0;
+
+        // remove the empty colors, and give each overflowed row a color.
+        int32_t num_colors = 0;
+        for ( int32_t c = 0; c < MAX_NUM_COLORS; c++ ) {
+
+            if ( work.m_color_begin[ c + 1 ] > work.m_color_begin[ c ] ) {
+                work.m_color_begin[ num_colors++ ] = work.m_color_begin[ c ];
             }
         }
+
+        const auto num_regular = work.m_color_begin[ MAX_NUM_COLORS ];
+        work.m_color_begin.resize( num_colors );
+
+        for ( int32_t k = 0; k <= num_overflows; k++ ) {
+
+            work.m_color_begin.push_back( num_regular + k );
+        }
     }
 
-    void assignLambdas()
+    // M is not formed. Each row keeps its Jacobian and the body indices.
+    void constructSequentialImpulseRows(
+        const Island&               island,
+        SequentialImpulseSolver<T>& si,
+        const T                     delta_t
+    ) {
+        const auto dim = (int32_t)island.m_constraints.size();
+
+        for ( int32_t b = 0; b < (int32_t)island.m_bodies.size(); b++ ) {
+
+            si.setBody( b, m_bodies[ island.m_bodies[ b ] ]->m_mass_inv );
+        }
+
+        for ( int i = 0; i < dim; i++ ) {
+
+            const auto  g   = island.m_constraints[ i ];
+            const auto& c_i = m_constraints[ g ];
+            const auto  b0  = m_body_index_0[ g ];
+            const auto  b1  = m_body_index_1[ g ];
+
+            si.setRow(
+                i,
+                ( b0 >= 0 ) ? m_local_body_index[ b0 ] : -1,
+                c_i->m_n0,
+                ( b1 >= 0 ) ? m_local_body_index[ b1 ] : -1,
+                c_i->m_n1,
+                m_cfm_sigma
+            );
+
+            si.setQ( i, calcQ( c_i, delta_t ) );
+
+            if ( i < island.m_dim_bi ) {
+
+                si.setNoLimits( i );
+                si.setInitialZ( i, c_i->m_lambda );
+            }
+            else {
+                si.setUnilateralLimits( i );
+                si.setInitialZ( i, std::max( (T)0.0, (T)c_i->m_lambda ) );
+            }
+        }
+    }
+
+    template<class SOLVER>
+    void assignLambdas( const Island& island, const SOLVER& solver )
     {
-        const auto dim_bi  = m_bilateral.size();
-        const auto dim_uni = m_unilateral.size();
+        const auto dim = (int32_t)island.m_constraints.size();
 
-        for ( int i = 0; i < dim_bi + dim_uni; i++ ) {
+        for ( int i = 0; i < dim; i++ ) {
 
-            auto& c = (i < dim_bi) ? m_bilateral[ i ] : m_unilateral[ i - dim_bi ];
-            c->m_lambda = m_mlcp.getZ( i );
-         }
+            m_constraints[ island.m_constraints[ i ] ]->m_lambda = (float)solver.getZ( i );
+        }
     }
 
-private:
+    T calcQ( const VelocityConstraint* c, const T delta_t ) const
+    {
+        T q = -1.0 * c->m_b;
+
+        if ( c->m_body_0 != nullptr ) {
+
+            q += dot( c->m_n0, c->m_body_0->m_lin_vel + c->m_body_0->m_force * delta_t * c->m_body_0->m_mass_inv );
+        }
+
+        if ( c->m_body_1 != nullptr ) {
+
+            q += dot( c->m_n1, c->m_body_1->m_lin_vel + c->m_body_1->m_force * delta_t * c->m_body_1->m_mass_inv );
+        }
 
-    MLCPSolverVanillaPGS<float>        m_mlcp;
-    const float                        m_cfm_sigma;
-    const float                        m_cfm_gamma;
+        return q * m_cfm_gamma;
+    }
+
+    // Vec2::dot() in T.
+    static T dot( const Vec2& a, const Vec2& b )
+    {
+        return (T)a.x * (T)b.x + (T)a.y * (T)b.y;
+    }
+
+    int32_t findOrAddBody( RigidBody* body )
+    {
+        if ( body == nullptr ) {
+            return -1;
+        }
+
+        const auto it = m_body_indices.find( body );
+        if ( it != m_body_indices.end() ) {
+            return it->second;
+        }
+
+        const auto index = (int32_t)m_bodies.size();
+        m_body_indices.emplace( body, index );
+        m_bodies.push_back( body );
+        return index;
+    }
+
+    // Accumulates n_i . n_j / m_b into M_ij for all the constraints j
+    // attached to the body b. i and j are the indices in the island.
+    void accumulateRow( IslandSolver& work, const int32_t i, const int32_t b, const Vec2& n_i )
+    {
+        if ( b < 0 ) {
+            return;
+        }
+
+        const auto mass_inv = m_bodies[ b ]->m_mass_inv;
+
+        for ( int32_t k = m_body_constraints_begin[ b ]; k < m_body_constraints_begin[ b + 1 ]; k++ ) {
+
+            const auto  g    = m_body_constraints[ k ];
+            const auto  j    = m_local_index[ g ];
+            const auto& c_j  = m_constraints[ g ];
+            const T     M_ij = dot( n_i, ( m_body_index_0[ g ] == b ) ? c_j->m_n0 : c_j->m_n1 ) * mass_inv;
+
+            if ( work.m_row_marker[ j ] != i ) {
+
+                work.m_row_marker[ j ] = i;
+                work.m_row_vals[ j ]   = M_ij;
+                work.m_row_cols.push_back( j );
+            }
+            else {
+                work.m_row_vals[ j ] += M_ij;
+            }
+        }
+    }
+
+    MLCPConvergencePolicy<T>           m_policy;
+    T                                  m_cfm_sigma;
+    T                                  m_cfm_gamma;
+    MLCPConvergencePolicy<float>       m_inner_policy;
+    typename MLCPSolverVanillaPGS<T>::StorageType
+                                       m_storage;
+    Backend                            m_backend;
+    bool                               m_direct_bilateral;
+    bool                               m_nncg;
+    T                                  m_pgs_relaxation;
+    bool                               m_adaptive_pgs_relaxation;
+    bool                               m_mixed_precision;
+    int32_t                            m_max_num_refinements;
+    T                                  m_jacobi_relaxation;
+    int32_t                            m_pivoting_max_dim;
+    int32_t                            m_parallel_island_threshold;
+    bool                               m_batch_small_islands;
 
     std::vector< VelocityConstraint* > m_unilateral;
     std::vector< VelocityConstraint* > m_bilateral;
+
+    // bilateral first, then unilateral.
+    std::vector< VelocityConstraint* > m_constraints;
+
+    std::unordered_map< RigidBody*, int32_t >
+                                       m_body_indices;
+    std::vector< RigidBody* >          m_bodies;
+    std::vector< int32_t >             m_body_index_0;
+    std::vector< int32_t >             m_body_index_1;
+
+    // body-to-constraint adjacency in CSR.
+    std::vector< int32_t >             m_body_constraints_begin;
+    std::vector< int32_t >             m_body_constraints;
+    std::vector< int32_t >             m_body_constraints_fill;
+
+    // union-find
+    std::vector< int32_t >             m_body_parent;
+    std::vector< int32_t >             m_root_island;
+
+    // islands and the indices of the constraints and the bodies in their islands.
+    std::vector< Island >              m_islands;
+    int32_t                            m_num_islands;
+    int32_t                            m_num_iterations;
+    std::vector< int32_t >             m_island_order;
+    std::vector< int32_t >             m_local_index;
+    std::vector< int32_t >             m_local_body_index;
+
+    // backend selection
+    std::vector< std::string >         m_registered_names;
+    std::vector< BackendFactory >      m_registered_factories;
+    std::vector< Selection >           m_selections;
+    std::unordered_map< RigidBody*, RecentSolve >
+                                       m_recent_solves; // by the first body of the island.
+    std::ostream*                      m_selection_log;
+    int32_t                            m_num_frames;
+
+    // the islands left to solveIsland() after the large ones, and the batches of the small ones.
+    std::vector< int32_t >             m_unbatched;
+    std::vector< Batch >               m_batches;
+    std::vector< std::unique_ptr< BatchSolver > >
+                                       m_batch_solvers;
+
+    std::vector< std::unique_ptr< IslandSolver > >
+                                       m_island_solvers;
+    ThreadPool                         m_thread_pool;
 };
 
 #endif /*__CONSTRAINTS_SOLVER_HPP__*/
@@ -0,0 +1,98 @@
+#ifndef __CONSTRAINTS_SOLVER_CONFIG_HPP__
+#define __CONSTRAINTS_SOLVER_CONFIG_HPP__
+
+#include <string>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <cstdint>
+
+#include "ConstraintsSolver.hpp"
+
+struct ConstraintsSolverConfig {
+
+    // The parameters of ConstraintsSolver that ConstraintsSolverTuner searches,
+    // saved and loaded as the lines of key=value. The default values are
+    // those of ConstraintsSolver. Unknown keys and '#' comments are ignored.
+    //
+    //   epsilon=1e-08
+    //   max_num_iterations=1000
+    //   max_stagnation=5
+    //   cfm_sigma=1e-06
+    //   cfm_gamma=0.999
+
+    double  m_epsilon            { 1.0e-8 };
+    int32_t m_max_num_iterations { 1000 };
+    int32_t m_max_stagnation     { 5 };
+    double  m_cfm_sigma          { 1.0e-6 };
+    double  m_cfm_gamma          { 0.999 };
+
+    template<class T>
+    void apply( ConstraintsSolver<T>& solver ) const
+    {
+        solver.convergencePolicy().setAbsoluteTolerance( (T)m_epsilon );
+        solver.convergencePolicy().setMaxNumIterations( m_max_num_iterations );
+        solver.convergencePolicy().setMaxStagnation( m_max_stagnation );
+        solver.setCFM( (T)m_cfm_sigma, (T)m_cfm_gamma );
+    }
+
+    // Returns false if the file can not be read or a value is malformed.
+    bool load( const std::string& path )
+    {
+        std::ifstream in( path );
+        if ( !in ) {
+            return false;
+        }
+
+        std::string line;
+
+        while ( std::getline( in, line ) ) {
+
+            const auto eq = line.find( '=' );
+
+            if ( line.empty() || line[0] == '#' || eq == std::string::npos ) {
+                continue;
+            }
+
+            const auto key = line.substr( 0, eq );
+            std::istringstream value( line.substr( eq + 1 ) );
+
+            if      ( key == "epsilon"            ) { value >> m_epsilon; }
+            else if ( key == "max_num_iterations" ) { value >> m_max_num_iterations; }
+            else if ( key == "max_stagnation"     ) { value >> m_max_stagnation; }
+            else if ( key == "cfm_sigma"          ) { value >> m_cfm_sigma; }
+            else if ( key == "cfm_gamma"          ) { value >> m_cfm_gamma; }
+            else {
+                continue;
+            }
+
+            if ( value.fail() ) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    bool save( const std::string& path ) const
+    {
+        std::ofstream out( path );
+        if ( !out ) {
+            return false;
+        }
+
+        write( out );
+        return (bool)out;
+    }
+
+    void write( std::ostream& out ) const
+    {
+        out << std::setprecision( 9 )
+            << "epsilon="            << m_epsilon            << "\n"
+            << "max_num_iterations=" << m_max_num_iterations << "\n"
+            << "max_stagnation="     << m_max_stagnation     << "\n"
+            << "cfm_sigma="          << m_cfm_sigma          << "\n"
+            << "cfm_gamma="          << m_cfm_gamma          << "\n";
+    }
+};
+
+#endif /*__CONSTRAINTS_SOLVER_CONFIG_HPP__*/
@@ -0,0 +1,241 @@
+#ifndef __CONSTRAINTS_SOLVER_TUNER_HPP__
+#define __CONSTRAINTS_SOLVER_TUNER_HPP__
+
+#include <vector>
+#include <string>
+#include <chrono>
+#include <limits>
+#include <ostream>
+#include <functional>
+#include <algorithm>
+
+#include "ConstraintsSolver.hpp"
+#include "ConstraintsSolverConfig.hpp"
+#include "ConstraintsRecorder.hpp"
+
+class ConstraintsSolverTuner {
+
+    // Searches ConstraintsSolverConfig for the least time to solve the recorded
+    // frames, subject to the largest violation over the frames being within the
+    // target. See ConstraintsRecorder::maxViolation().
+    //
+    // The search is the coordinate descent from the given config. Each parameter
+    // in turn is set to each of its candidate values with the others fixed, and
+    // the best config is kept. It repeats until a pass changes nothing.
+    // A feasible config is better than an infeasible one, two feasible ones are
+    // compared by the time, and two infeasible ones by the violation. The time
+    // must be shorter by TIME_MARGIN to replace the best, so that the timing
+    // noise does not move the search.
+    //
+    // The time of a frame is the minimum of num_repeats solves.
+
+public:
+
+    static constexpr int32_t MAX_NUM_PASSES = 4;
+    static constexpr double  TIME_MARGIN    = 0.03;
+
+    struct Evaluation {
+
+        double  m_time_ms;
+        float   m_violation;
+        int32_t m_iterations;
+        bool    m_feasible;
+    };
+
+    ConstraintsSolverTuner(
+        ConstraintsRecorder& frames,
+        const float          target_violation,
+        const int32_t        num_repeats = 3,
+        const int32_t        num_workers = ThreadPool::defaultNumWorkers()
+    )
+        :m_frames           { frames }
+        ,m_target_violation { target_violation }
+        ,m_num_repeats      { num_repeats }
+        ,m_solver           { num_workers }
+    {
+        m_parameters.push_back( Parameter{
+            "epsilon",
+            { 1.0e-4, 1.0e-5, 1.0e-6, 1.0e-7, 1.0e-8 },
+            []( ConstraintsSolverConfig& c, const double v ){ c.m_epsilon = v; }
+        } );
+        m_parameters.push_back( Parameter{
+            "max_num_iterations",
+            { 10, 25, 50, 100, 200, 400, 1000 },
+            []( ConstraintsSolverConfig& c, const double v ){ c.m_max_num_iterations = (int32_t)v; }
+        } );
+        m_parameters.push_back( Parameter{
+            "max_stagnation",
+            { 1, 2, 5, 10 },
+            []( ConstraintsSolverConfig& c, const double v ){ c.m_max_stagnation = (int32_t)v; }
+        } );
+        m_parameters.push_back( Parameter{
+            "cfm_sigma",
+            { 1.0e-4, 1.0e-5, 1.0e-6, 1.0e-7 },
+            []( ConstraintsSolverConfig& c, const double v ){ c.m_cfm_sigma = v; }
+        } );
+        m_parameters.push_back( Parameter{
+            "cfm_gamma",
+            { 0.99, 0.995, 0.999, 1.0 },
+            []( ConstraintsSolverConfig& c, const double v ){ c.m_cfm_gamma = v; }
+        } );
+    }
+
+    ~ConstraintsSolverTuner()
+    {
+    }
+
+    // Each evaluation is written to log if not nullptr.
+    ConstraintsSolverConfig tune( const ConstraintsSolverConfig& initial, std::ostream* log = nullptr )
+    {
+        auto best      = initial;
+        auto best_eval = evaluate( best );
+
+        writeLog( log, "initial", best, best_eval );
+
+        for ( int32_t pass = 0; pass < MAX_NUM_PASSES; pass++ ) {
+
+            bool changed = false;
+
+            for ( const auto& parameter : m_parameters ) {
+
+                for ( const auto v : parameter.m_candidates ) {
+
+                    auto config = best;
+                    parameter.m_set( config, v );
+
+                    const auto eval = evaluate( config );
+
+                    writeLog( log, parameter.m_name, config, eval );
+
+                    if ( isBetter( eval, best_eval ) ) {
+
+                        best      = config;
+                        best_eval = eval;
+                        changed   = true;
+                    }
+                }
+            }
+
+            if ( !changed ) {
+                break;
+            }
+        }
+
+        writeLog( log, "best", best, best_eval );
+
+        return best;
+    }
+
+    // Evaluates the config with each of the backends in turn, e.g. to see
+    // if a backend plugged in with registerBackend() pays off on the frames.
+    // The last backend is left set to the solver.
+    std::vector< Evaluation > compareBackends(
+        const ConstraintsSolverConfig&                          config,
+        const std::vector< ConstraintsSolver<float>::Backend >& backends,
+        std::ostream*                                           log = nullptr
+    ) {
+        std::vector< Evaluation > evals;
+
+        for ( const auto backend : backends ) {
+
+            m_solver.setBackend( backend );
+
+            evals.push_back( evaluate( config ) );
+
+            writeLog( log, m_solver.backendName( backend ), config, evals.back() );
+        }
+        return evals;
+    }
+
+    // The solver the configs are evaluated on, e.g. to register a backend.
+    ConstraintsSolver<float>& solver()
+    {
+        return m_solver;
+    }
+
+    Evaluation evaluate( const ConstraintsSolverConfig& config )
+    {
+        config.apply( m_solver );
+
+        Evaluation eval{ 0.0, 0.0f, 0, false };
+
+        for ( int32_t i = 0; i < m_frames.numFrames(); i++ ) {
+
+            auto& frame = m_frames.frame( i );
+
+            double best_ms = std::numeric_limits<double>::max();
+
+            for ( int32_t r = 0; r < m_num_repeats; r++ ) {
+
+                const auto t0 = std::chrono::steady_clock::now();
+
+                m_frames.replay( m_solver, frame );
+
+                const auto t1 = std::chrono::steady_clock::now();
+
+                best_ms = std::min( best_ms, std::chrono::duration<double, std::milli>( t1 - t0 ).count() );
+            }
+
+            eval.m_time_ms    += best_ms;
+            eval.m_violation   = std::max( eval.m_violation, ConstraintsRecorder::maxViolation( frame ) );
+            eval.m_iterations += m_solver.numIterations();
+        }
+
+        eval.m_feasible = eval.m_violation <= m_target_violation;
+
+        return eval;
+    }
+
+private:
+
+    struct Parameter {
+
+        std::string                                                     m_name;
+        std::vector< double >                                           m_candidates;
+        std::function< void( ConstraintsSolverConfig&, const double ) > m_set;
+    };
+
+    bool isBetter( const Evaluation& a, const Evaluation& b ) const
+    {
+        if ( a.m_feasible != b.m_feasible ) {
+            return a.m_feasible;
+        }
+
+        if ( a.m_feasible ) {
+            return a.m_time_ms < b.m_time_ms * ( 1.0 - TIME_MARGIN );
+        }
+
+        return a.m_violation < b.m_violation;
+    }
+
+    void writeLog(
+        std::ostream*                  log,
+        const std::string&             label,
+        const ConstraintsSolverConfig& config,
+        const Evaluation&              eval
+    ) const {
+        if ( log == nullptr ) {
+            return;
+        }
+
+        *log << label
+             << " epsilon "    << config.m_epsilon
+             << " iterations " << config.m_max_num_iterations
+             << " stagnation " << config.m_max_stagnation
+             << " sigma "      << config.m_cfm_sigma
+             << " gamma "      << config.m_cfm_gamma
+             << " : time "     << eval.m_time_ms << " ms"
+             << " violation "  << eval.m_violation
+             << " sweeps "     << eval.m_iterations
+             << ( eval.m_feasible ? "" : " (infeasible)" )
+             << "\n";
+    }
+
+    ConstraintsRecorder&     m_frames;
+    const float              m_target_violation;
+    const int32_t            m_num_repeats;
+    ConstraintsSolver<float> m_solver;
+    std::vector< Parameter > m_parameters;
+};
+
+#endif /*__CONSTRAINTS_SOLVER_TUNER_HPP__*/
@@ -0,0 +1,92 @@
+#ifndef __CONTACT_CACHE_HPP__
+#define __CONTACT_CACHE_HPP__
+
+#include <vector>
+#include <unordered_map>
+#include <functional>
+
+#include "VelocityConstraint.hpp"
+
+class ContactCache {
+
+    // Keeps the lambdas of the constraints of the previous frame keyed by
+    // the type, the pair of bodies and the feature id (e.g. the wall),
+    // and gives them to the constraints of the current frame as the initial
+    // values for the solver (warm starting).
+
+public:
+
+    ContactCache()
+    {
+    }
+
+    ~ContactCache()
+    {
+    }
+
+    void clear()
+    {
+        m_lambdas.clear();
+    }
+
+    // Sets the lambda of the same constraint in the previous frame to c->m_lambda.
+    void warmStart( VelocityConstraint* c ) const
+    {
+        const auto it = m_lambdas.find( Key{ c } );
+
+        c->m_lambda = ( it != m_lambdas.end() ) ? it->second : 0.0f;
+    }
+
+    // Replaces the contents with the lambdas of the current frame.
+    void update( const std::vector< VelocityConstraint* >& constraints )
+    {
+        m_lambdas.clear();
+
+        for ( const auto* c : constraints ) {
+
+            m_lambdas[ Key{ c } ] = c->m_lambda;
+        }
+    }
+
+private:
+
+    struct Key {
+
+        Key( const VelocityConstraint* c )
+            :m_type       { c->m_type }
+            ,m_body_0     { c->m_body_0 }
+            ,m_body_1     { c->m_body_1 }
+            ,m_feature_id { c->m_feature_id }
+        {
+        }
+
+        bool operator==( const Key& rhs ) const
+        {
+            return    m_type       == rhs.m_type
+                   && m_body_0     == rhs.m_body_0
+                   && m_body_1     == rhs.m_body_1
+                   && m_feature_id == rhs.m_feature_id;
+        }
+
+        VelocityConstraint::Type m_type;
+        const RigidBody*         m_body_0;
+        const RigidBody*         m_body_1;
+        int32_t                  m_feature_id;
+    };
+
+    struct KeyHash {
+
+        size_t operator()( const Key& k ) const
+        {
+            size_t h = std::hash< const RigidBody* >{}( k.m_body_0 );
+            h = h * 31 + std::hash< const RigidBody* >{}( k.m_body_1 );
+            h = h * 31 + std::hash< int32_t >{}( k.m_feature_id );
+            h = h * 31 + std::hash< int32_t >{}( (int32_t)k.m_type );
+            return h;
+        }
+    };
+
+    std::unordered_map< Key, float, KeyHash > m_lambdas;
+};
+
+#endif /*__CONTACT_CACHE_HPP__*/
@@ -0,0 +1,164 @@
+#ifndef __HASH_GRID_BROADPHASE_HPP__
+#define __HASH_GRID_BROADPHASE_HPP__
+
+#include <vector>
+#include <utility>
+#include <algorithm>
+#include <cstdint>
+#include <cmath>
+
+#include "Vec2.hpp"
+#include "Broadphase.hpp"
+
+class HashGridBroadphase : public Broadphase {
+
+    // Finds the candidate pairs of the discs whose bounding boxes, enlarged
+    // by the margin, overlap, in O(n) for the discs of similar sizes.
+    //
+    // The grid is rebuilt in each findPairs(). The cell size is the largest
+    // diameter plus the margin, so that a disc can overlap only with the discs
+    // in its cell and the 8 cells around it. The cells are hashed into the
+    // buckets of the power of 2 at least twice the number of the discs, and the
+    // discs are sorted into the buckets with the counting sort. The cell, the
+    // center and the radius are copied in the sorted order, so that a bucket
+    // is scanned contiguously. The discs of the other cells that collide in
+    // the hash are skipped by the cell.
+    //
+    // The pairs are sorted by i and then j, so that the constraints are
+    // generated in the same order as the loop over all the pairs.
+
+public:
+
+    HashGridBroadphase()
+        :m_cell_size { 1.0f }
+        ,m_mask      { 0 }
+    {
+    }
+
+    virtual ~HashGridBroadphase()
+    {
+    }
+
+    void findPairs(
+        const std::vector< Vec2 >&                    centers,
+        const std::vector< float >&                   radii,
+        const float                                   margin,
+        std::vector< std::pair< int32_t, int32_t > >& pairs
+    ) override {
+        pairs.clear();
+
+        const auto n = (int32_t)centers.size();
+        if ( n < 2 ) {
+            return;
+        }
+
+        build( centers, radii, margin );
+
+        for ( int32_t i = 0; i < n; i++ ) {
+
+            const auto first = pairs.size();
+
+            for ( int32_t dy = -1; dy <= 1; dy++ ) {
+
+                for ( int32_t dx = -1; dx <= 1; dx++ ) {
+
+                    const auto cx     = m_cell_x[ i ] + dx;
+                    const auto cy     = m_cell_y[ i ] + dy;
+                    const auto bucket = hash( cx, cy );
+
+                    for ( int32_t k = m_bucket_begin[ bucket ]; k < m_bucket_begin[ bucket + 1 ]; k++ ) {
+
+                        const auto& e = m_sorted[ k ];
+
+                        if ( e.m_index <= i || e.m_cell_x != cx || e.m_cell_y != cy ) {
+                            continue;
+                        }
+
+                        const auto reach = radii[ i ] + e.m_radius + margin;
+
+                        if (    std::abs( centers[ i ].x - e.m_center.x ) <= reach
+                             && std::abs( centers[ i ].y - e.m_center.y ) <= reach
+                             && accepts( i, e.m_index )
+                        ) {
+                            pairs.emplace_back( i, e.m_index );
+                        }
+                    }
+                }
+            }
+
+            std::sort( pairs.begin() + first, pairs.end() );
+        }
+    }
+
+private:
+
+    struct Entry {
+
+        int32_t m_index;
+        int32_t m_cell_x;
+        int32_t m_cell_y;
+        float   m_radius;
+        Vec2    m_center;
+    };
+
+    void build( const std::vector< Vec2 >& centers, const std::vector< float >& radii, const float margin )
+    {
+        const auto n = (int32_t)centers.size();
+
+        m_cell_size = 2.0f * ( *std::max_element( radii.begin(), radii.end() ) ) + margin;
+
+        int32_t num_buckets = 1;
+        while ( num_buckets < 2 * n ) {
+            num_buckets *= 2;
+        }
+        m_mask = num_buckets - 1;
+
+        m_cell_x.resize( n );
+        m_cell_y.resize( n );
+        m_bucket_of.resize( n );
+        m_sorted.resize( n );
+        m_bucket_begin.assign( num_buckets + 1, 0 );
+
+        for ( int32_t i = 0; i < n; i++ ) {
+
+            m_cell_x[ i ]    = (int32_t)std::floor( centers[ i ].x / m_cell_size );
+            m_cell_y[ i ]    = (int32_t)std::floor( centers[ i ].y / m_cell_size );
+            m_bucket_of[ i ] = hash( m_cell_x[ i ], m_cell_y[ i ] );
+
+            m_bucket_begin[ m_bucket_of[ i ] + 1 ]++;
+        }
+
+        for ( int32_t b = 0; b < num_buckets; b++ ) {
+
+            m_bucket_begin[ b + 1 ] += m_bucket_begin[ b ];
+        }
+
+        m_bucket_fill.assign( m_bucket_begin.begin(), m_bucket_begin.end() - 1 );
+
+        for ( int32_t i = 0; i < n; i++ ) {
+
+            m_sorted[ m_bucket_fill[ m_bucket_of[ i ] ]++ ] = Entry{ i, m_cell_x[ i ], m_cell_y[ i ], radii[ i ], centers[ i ] };
+        }
+    }
+
+    int32_t hash( const int32_t cx, const int32_t cy ) const
+    {
+        const auto h = (uint32_t)cx * 73856093u ^ (uint32_t)cy * 19349663u;
+
+        return (int32_t)( h & (uint32_t)m_mask );
+    }
+
+    float                  m_cell_size;
+    int32_t                m_mask;
+
+    std::vector< int32_t > m_cell_x;
+    std::vector< int32_t > m_cell_y;
+    std::vector< int32_t > m_bucket_of;
+
+    // the discs sorted by the bucket in CSR.
+    std::vector< int32_t > m_bucket_begin;
+    std::vector< int32_t > m_bucket_fill;
+    std::vector< Entry >   m_sorted;
+};
+
+#endif /*__HASH_GRID_BROADPHASE_HPP__*/
@@ -0,0 +1,96 @@
+#ifndef __MLCP_BACKEND_HPP__
+#define __MLCP_BACKEND_HPP__
+
+#include <cstdint>
+
+#include "MLCPConvergencePolicy.hpp"
+
+template<class T>
+class MLCPBackend {
+
+    // The interface of an MLCP solver plugged into ConstraintsSolver with
+    // registerBackend(). The rows are given in the same way as to the built-in
+    // solvers, i.e., the first dim_bi rows are bilateral and have no limits,
+    // and the others are unilateral.
+
+public:
+
+    virtual ~MLCPBackend()
+    {
+    }
+
+    virtual void prepare( const int32_t dim, const int32_t dim_bi ) = 0;
+
+    virtual void setNoLimits        ( const int32_t i ) = 0;
+    virtual void setUnilateralLimits( const int32_t i ) = 0;
+    virtual void setM               ( const int32_t i, const int32_t j, const T v ) = 0;
+    virtual void setQ               ( const int32_t i, const T v ) = 0;
+    virtual void setInitialZ        ( const int32_t i, const T v ) = 0;
+
+    virtual void run() = 0;
+
+    virtual T       getZ( const int32_t i ) const = 0;
+    virtual int32_t getIterations() const = 0;
+
+    // The policy of ConstraintsSolver is assigned before each prepare().
+    virtual MLCPConvergencePolicy<T>& convergencePolicy() = 0;
+};
+
+// MLCPBackend over a solver with the interface of MLCPSolverAPGD.
+template<class T, class SOLVER>
+class MLCPBackendAdapter : public MLCPBackend<T> {
+
+public:
+
+    MLCPBackendAdapter()
+        :m_solver{ 0.0, 0, 0 }
+    {
+    }
+
+    virtual ~MLCPBackendAdapter()
+    {
+    }
+
+    // The solver treats the bilateral rows by their limits.
+    void prepare( const int32_t dim, const int32_t ) override
+    {
+        m_solver.prepare( dim );
+    }
+
+    void setNoLimits        ( const int32_t i )                             override { m_solver.setNoLimits( i );         }
+    void setUnilateralLimits( const int32_t i )                             override { m_solver.setUnilateralLimits( i ); }
+    void setM               ( const int32_t i, const int32_t j, const T v ) override { m_solver.setM( i, j, v );          }
+    void setQ               ( const int32_t i, const T v )                  override { m_solver.setQ( i, v );             }
+    void setInitialZ        ( const int32_t i, const T v )                  override { m_solver.setInitialZ( i, v );      }
+
+    void run() override
+    {
+        m_solver.run();
+    }
+
+    T getZ( const int32_t i ) const override
+    {
+        return m_solver.getZ( i );
+    }
+
+    int32_t getIterations() const override
+    {
+        return m_solver.getIterations();
+    }
+
+    MLCPConvergencePolicy<T>& convergencePolicy() override
+    {
+        return m_solver.convergencePolicy();
+    }
+
+    SOLVER& solver()
+    {
+        return m_solver;
+    }
+
+private:
+
+    SOLVER m_solver;
+};
+
+#endif /*__MLCP_BACKEND_HPP__*/
@@ -0,0 +1,181 @@
+#ifndef __MLCP_CONVERGENCE_POLICY_HPP__
+#define __MLCP_CONVERGENCE_POLICY_HPP__
+
+#include <vector>
+#include <chrono>
+#include <cstdint>
+#include <algorithm>
+
+template<class T>
+class MLCPConvergencePolicy {
+
+    // Decides when an iterative MLCP solver terminates.
+    //
+    //   - Converged        : error <= absolute tolerance, or
+    //                        error <= relative tolerance * the first error.
+    //   - Stagnated        : the error has increased more than max_stagnation
+    //                        times within the last stagnation_window checks.
+    //                        The window 0 means since the start.
+    //   - MaxIterations    : the number of iterations reached the cap.
+    //   - DeadlineExceeded : the wall-clock time since start() exceeded the deadline.
+    //                        The deadline 0 means no deadline.
+    //
+    // The error is checked every check_interval iterations. Each update is O(1).
+
+public:
+
+    typedef enum _Status {
+        Continue,
+        Converged,
+        Stagnated,
+        MaxIterations,
+        DeadlineExceeded
+    } Status;
+
+    MLCPConvergencePolicy(
+        const T       abs_tolerance,
+        const int32_t max_num_iterations,
+        const int32_t max_stagnation
+    )
+        :m_abs_tolerance      { abs_tolerance }
+        ,m_rel_tolerance      { 0.0 }
+        ,m_max_num_iterations { max_num_iterations }
+        ,m_max_stagnation     { max_stagnation }
+        ,m_stagnation_window  { 0 }
+        ,m_check_interval     { 1 }
+        ,m_deadline           { 0 }
+    {
+        start();
+    }
+
+    ~MLCPConvergencePolicy()
+    {
+    }
+
+    void setAbsoluteTolerance( const T tol )
+    {
+        m_abs_tolerance = tol;
+    }
+
+    void setRelativeTolerance( const T tol )
+    {
+        m_rel_tolerance = tol;
+    }
+
+    void setMaxNumIterations( const int32_t n )
+    {
+        m_max_num_iterations = n;
+    }
+
+    int32_t maxNumIterations() const
+    {
+        return m_max_num_iterations;
+    }
+
+    void setMaxStagnation( const int32_t n )
+    {
+        m_max_stagnation = n;
+    }
+
+    void setStagnationWindow( const int32_t n )
+    {
+        m_stagnation_window = n;
+    }
+
+    void setCheckInterval( const int32_t n )
+    {
+        m_check_interval = std::max( 1, n );
+    }
+
+    void setDeadline( const std::chrono::microseconds d )
+    {
+        m_deadline = d;
+    }
+
+    // Called at the beginning of each solve.
+    void start()
+    {
+        m_start_time        = std::chrono::steady_clock::now();
+        m_num_checks        = 0;
+        m_first_error       = 0.0;
+        m_last_error        = 0.0;
+        m_stagnation_count  = 0;
+        m_window_pos        = 0;
+        m_window.assign( m_stagnation_window, 0 );
+    }
+
+    // True if the solver must calculate the error in the given iteration.
+    bool isCheckIteration( const int32_t iteration ) const
+    {
+        return ( iteration + 1 ) % m_check_interval == 0;
+    }
+
+    // Called at the end of each iteration. error is used only in the check iterations.
+    Status update( const int32_t iteration, const T error )
+    {
+        if ( isCheckIteration( iteration ) ) {
+
+            const auto status = checkError( error );
+            if ( status != Continue ) {
+                return status;
+            }
+        }
+
+        if ( iteration + 1 >= m_max_num_iterations ) {
+            return MaxIterations;
+        }
+
+        if ( m_deadline.count() > 0 && std::chrono::steady_clock::now() - m_start_time > m_deadline ) {
+            return DeadlineExceeded;
+        }
+
+        return Continue;
+    }
+
+private:
+
+    Status checkError( const T error )
+    {
+        if ( m_num_checks == 0 ) {
+            m_first_error = error;
+        }
+
+        if ( error <= m_abs_tolerance || error <= m_rel_tolerance * m_first_error ) {
+            return Converged;
+        }
+
+        const uint8_t increased = ( m_num_checks > 0 && m_last_error < error ) ? 1 : 0;
+
+        m_last_error = error;
+        m_num_checks++;
+
+        if ( m_stagnation_window > 0 ) {
+
+            m_stagnation_count -= m_window[ m_window_pos ];
+            m_window[ m_window_pos ] = increased;
+            m_window_pos = ( m_window_pos + 1 ) % m_stagnation_window;
+        }
+        m_stagnation_count += increased;
+
+        return ( m_stagnation_count > m_max_stagnation ) ? Stagnated : Continue;
+    }
+
+    T                         m_abs_tolerance;
+    T                         m_rel_tolerance;
+    int32_t                   m_max_num_iterations;
+    int32_t                   m_max_stagnation;
+    int32_t                   m_stagnation_window;
+    int32_t                   m_check_interval;
+    std::chrono::microseconds m_deadline;
+
+    std::chrono::steady_clock::time_point
+                              m_start_time;
+    int32_t                   m_num_checks;
+    T                         m_first_error;
+    T                         m_last_error;
+    int32_t                   m_stagnation_count;
+    int32_t                   m_window_pos;
+    std::vector<uint8_t>      m_window;
+};
+
+#endif /*__MLCP_CONVERGENCE_POLICY_HPP__*/
@@ -0,0 +1,305 @@
+#ifndef __MLCP_SOLVER_APGD_HPP__
+#define __MLCP_SOLVER_APGD_HPP__
+
+#include <vector>
+#include <limits>
+#include <algorithm>
+#include <cmath>
+
+#include "SparseMatrixCSR.hpp"
+#include "MLCPConvergencePolicy.hpp"
+
+template<class T>
+class MLCPSolverAPGD {
+
+    // Solves the same problem as MLCPSolverVanillaPGS as the box-constrained QP
+    //
+    //   min 1/2 z^T M z + q^T z,  lo <= z <= hi
+    //
+    // with the accelerated projected gradient descent (Nesterov) and the
+    // adaptive restart [O'Donoghue & Candes 2015].
+    //
+    //   g       = M y^r + q
+    //   z^{r+1} = clamp( y^r - G^-1 g )
+    //   y^{r+1} = z^{r+1} + beta_r ( z^{r+1} - z^r )
+    //
+    // G is the diagonal of the absolute row sums of M. G - M is diagonally
+    // dominant, so the step G^-1 is safe without estimating the Lipschitz
+    // constant, and the scaling by rows takes care of the mass ratios.
+    // The momentum is reset when g . ( z^{r+1} - z^r ) > 0.
+    //
+    // Each iteration is one sparse matrix-vector product. In the check
+    // iterations another product M z is taken for the error, which is the same
+    // natural residual as the PGS. The iterates are not monotone, so the
+    // z with the smallest error is kept as the solution, and the smallest
+    // error so far is given to the convergence policy. Otherwise the
+    // oscillation after each restart would be taken as a stagnation.
+    // Instead, the solver stagnates if the smallest error has not improved
+    // in max_checks_without_improvement consecutive checks.
+    //
+    // setM() must be called row by row in the increasing order of rows,
+    // and only for the non-zero elements.
+
+public:
+
+    MLCPSolverAPGD(
+        const T       epsilon,
+        const int32_t max_num_iterations,
+        const int32_t max_stagnation
+    )
+        :m_policy      { epsilon, max_num_iterations, max_stagnation }
+        ,m_dim         { 0 }
+        ,m_iterations  { 0 }
+        ,m_num_restarts{ 0 }
+        ,m_best_error  { 0.0 }
+        ,m_max_checks_without_improvement{ 50 }
+        ,m_status      { MLCPConvergencePolicy<T>::Continue }
+    {
+        static_assert(    std::is_same< float, T >::value
+                       || std::is_same< double,T >::value );
+    }
+
+    ~MLCPSolverAPGD()
+    {
+    }
+
+    void setMaxChecksWithoutImprovement( const int32_t n )
+    {
+        m_max_checks_without_improvement = n;
+    }
+
+    void prepare( const int32_t dim )
+    {
+        m_dim = dim;
+        m_error_history.clear();
+        m_iterations   = 0;
+        m_num_restarts = 0;
+        m_status       = MLCPConvergencePolicy<T>::Continue;
+
+        m_M.reset( dim );
+
+        m_q.assign     ( dim, 0.0 );
+        m_z.assign     ( dim, 0.0 );
+        m_z_next.assign( dim, 0.0 );
+        m_z_best.assign( dim, 0.0 );
+        m_y.assign     ( dim, 0.0 );
+        m_g.assign     ( dim, 0.0 );
+        m_z_lo.assign  ( dim, 0.0 );
+        m_z_hi.assign  ( dim, 0.0 );
+        m_step.assign  ( dim, 0.0 );
+    }
+
+    void setNoLimits( const int32_t i )
+    {
+        m_z_lo[i] = -1.0 * std::numeric_limits<T>::max();
+        m_z_hi[i] = std::numeric_limits<T>::max();
+    }
+
+    void setUnilateralLimits( const int32_t i )
+    {
+        m_z_lo[i] = 0.0;
+        m_z_hi[i] = std::numeric_limits<T>::max();
+    }
+
+    void setLimits( const int32_t i, const T lo, const T hi )
+    {
+        m_z_lo[i] = lo;
+        m_z_hi[i] = hi;
+    }
+
+    void setM( const int32_t i, const int32_t j, const T v )
+    {
+        m_M.append( i, j, v );
+    }
+
+    void setQ( const int32_t i, const T v )
+    {
+        m_q[ i ] = v;
+    }
+
+    // Initial value for warm starting. It must be within the limits.
+    void setInitialZ( const int32_t i, const T v )
+    {
+        m_z[ i ] = v;
+    }
+
+    void run()
+    {
+        m_M.finish();
+
+        calcSteps();
+
+        m_y          = m_z;
+        m_z_best     = m_z;
+        m_best_error = std::numeric_limits<T>::max();
+
+        T       theta = 1.0;
+        int32_t checks_without_improvement = 0;
+
+        m_policy.start();
+        m_status = MLCPConvergencePolicy<T>::Continue;
+
+        for ( m_iterations = 0; m_status == MLCPConvergencePolicy<T>::Continue; m_iterations++ ) {
+
+            T g_dot_dz = 0.0;
+
+            for ( int32_t i = 0; i < m_dim; i++ ) {
+
+                m_g[ i ] = m_M.rowDot( i, m_y.data() ) + m_q[ i ];
+
+                m_z_next[ i ] = clamp( m_y[ i ] - m_g[ i ] * m_step[ i ], m_z_lo[ i ], m_z_hi[ i ] );
+
+                g_dot_dz += m_g[ i ] * ( m_z_next[ i ] - m_z[ i ] );
+            }
+
+            T beta = 0.0;
+
+            if ( g_dot_dz > 0.0 ) {
+
+                theta = 1.0;
+                m_num_restarts++;
+            }
+            else {
+                const T theta_next = 0.5 * ( 1.0 + std::sqrt( 1.0 + 4.0 * theta * theta ) );
+
+                beta  = ( theta - 1.0 ) / theta_next;
+                theta = theta_next;
+            }
+
+            for ( int32_t i = 0; i < m_dim; i++ ) {
+
+                m_y[ i ] = m_z_next[ i ] + beta * ( m_z_next[ i ] - m_z[ i ] );
+            }
+
+            std::swap( m_z, m_z_next );
+
+            T error = 0.0;
+
+            if ( m_policy.isCheckIteration( m_iterations ) ) {
+
+                error = calcError();
+
+                if ( error < m_best_error ) {
+
+                    m_best_error = error;
+                    m_z_best     = m_z;
+                    checks_without_improvement = 0;
+                }
+                else {
+                    checks_without_improvement++;
+                }
+
+                m_error_history.push_back( error );
+
+                error = m_best_error;
+            }
+
+            m_status = m_policy.update( m_iterations, error );
+
+            if (    m_status == MLCPConvergencePolicy<T>::Continue
+                 && checks_without_improvement > m_max_checks_without_improvement
+            ) {
+                m_status = MLCPConvergencePolicy<T>::Stagnated;
+            }
+        }
+
+        if ( m_best_error < std::numeric_limits<T>::max() ) {
+
+            m_z = m_z_best;
+        }
+    }
+
+    const T getZ( const int32_t i ) const
+    {
+        return m_z[i];
+    }
+
+    T getError() const
+    {
+        if ( m_error_history.empty() ) {
+            return 0.0;
+        }
+        return m_best_error;
+    }
+
+    int32_t getIterations() const
+    {
+        return m_iterations;
+    }
+
+    int32_t getNumRestarts() const
+    {
+        return m_num_restarts;
+    }
+
+    typename MLCPConvergencePolicy<T>::Status getStatus() const
+    {
+        return m_status;
+    }
+
+    MLCPConvergencePolicy<T>& convergencePolicy()
+    {
+        return m_policy;
+    }
+
+private:
+
+    // step_i = 1 / G_ii
+    void calcSteps()
+    {
+        for ( int32_t i = 0; i < m_dim; i++ ) {
+
+            T sum = 0.0;
+
+            for ( int32_t k = m_M.rowBegin( i ); k < m_M.rowEnd( i ); k++ ) {
+
+                sum += std::abs( m_M.val( k ) );
+            }
+            m_step[ i ] = 1.0 / sum;
+        }
+    }
+
+    // The sum of | z_i - clamp( z_i - w_i / M_ii ) | * M_ii at the current z.
+    T calcError() const
+    {
+        T error = 0.0;
+
+        for ( int32_t i = 0; i < m_dim; i++ ) {
+
+            const T w    = m_M.rowDot( i, m_z.data() ) + m_q[ i ];
+            const T diag = m_M.diagonal( i );
+
+            error += std::abs( m_z[ i ] - clamp( m_z[ i ] - w / diag, m_z_lo[ i ], m_z_hi[ i ] ) ) * diag;
+        }
+        return error;
+    }
+
+    T clamp( const T val, const T lo, const T hi ) const
+    {
+        return std::min ( std::max ( val, lo ), hi );
+    }
+
+    MLCPConvergencePolicy<T>
+                         m_policy;
+    std::vector<T>       m_error_history;
+
+    int32_t              m_dim;
+    SparseMatrixCSR<T>   m_M;
+    std::vector<T>       m_q;
+    std::vector<T>       m_z;
+    std::vector<T>       m_z_next;
+    std::vector<T>       m_z_best;
+    std::vector<T>       m_y;
+    std::vector<T>       m_g;
+    std::vector<T>       m_z_lo;
+    std::vector<T>       m_z_hi;
+    std::vector<T>       m_step;
+    int32_t              m_iterations;
+    int32_t              m_num_restarts;
+    T                    m_best_error;
+    int32_t              m_max_checks_without_improvement;
+    typename MLCPConvergencePolicy<T>::Status
+                         m_status;
+};
+
+#endif /*__MLCP_SOLVER_APGD_HPP__*/
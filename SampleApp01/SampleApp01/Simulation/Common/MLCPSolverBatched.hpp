@@ -0,0 +1,332 @@
+#ifndef __MLCP_SOLVER_BATCHED_HPP__
+#define __MLCP_SOLVER_BATCHED_HPP__
+
+#include <array>
+#include <vector>
+#include <limits>
+#include <algorithm>
+#include <cmath>
+
+#include "MLCPConvergencePolicy.hpp"
+#include "SIMDFloat8.hpp"
+
+template<int32_t N>
+class MLCPSolverBatched {
+
+    // Up to NUM_LANES independent MLCPs of dim <= N solved at once with the
+    // PGS in float, one system per lane of Float8.
+    //
+    // The systems are kept in SoA, i.e., the element (i, j) of M of all the
+    // lanes are next to each other, and so are q_i, z_i and the limits. The rows
+    // and the columns from the dim of each system to N are padded with 0.
+    //
+    // As in MLCPSolverFixed, w = M z + q is kept up to date, and relaxing the
+    // row i of all the lanes is
+    //
+    //   z_i = clamp( z_i - w_i * step_i, lo_i, hi_i )
+    //   w  += M_{:,i} ( z_i - z_i^prev )
+    //
+    // with the Float8 operations only. Each lane has its own convergence
+    // policy. When a lane stops, its step is masked to 0, so that its z does
+    // not change anymore while the others go on. The padded rows and the
+    // unused lanes have the step 0 from the beginning. The rows beyond the
+    // largest dim of the lanes are not visited, and the update of w is skipped
+    // if z_i has changed in none of the lanes.
+    //
+    // The direct solve of the bilateral rows is not available. They are
+    // relaxed with the others.
+
+public:
+
+    static_assert( N > 0 && N <= 16, "for the small problems only" );
+
+    static constexpr int32_t NUM_LANES = 8;
+    static constexpr int32_t MAX_DIM   = N;
+
+    // The view of a lane with the interface of a single MLCP solver.
+    class Lane {
+
+    public:
+
+        Lane( MLCPSolverBatched& batch, const int32_t lane )
+            :m_batch { batch }
+            ,m_lane  { lane  }
+        {
+        }
+
+        void setNoLimits        ( const int32_t i )                                  { m_batch.setNoLimits        ( m_lane, i );        }
+        void setUnilateralLimits( const int32_t i )                                  { m_batch.setUnilateralLimits( m_lane, i );        }
+        void setLimits          ( const int32_t i, const float lo, const float hi )  { m_batch.setLimits          ( m_lane, i, lo, hi ); }
+        void setM               ( const int32_t i, const int32_t j, const float v )  { m_batch.setM               ( m_lane, i, j, v );  }
+        void setQ               ( const int32_t i, const float v )                   { m_batch.setQ               ( m_lane, i, v );     }
+        void setInitialZ        ( const int32_t i, const float v )                   { m_batch.setInitialZ        ( m_lane, i, v );     }
+
+        float getZ( const int32_t i ) const
+        {
+            return m_batch.getZ( m_lane, i );
+        }
+
+    private:
+
+        MLCPSolverBatched& m_batch;
+        const int32_t      m_lane;
+    };
+
+    MLCPSolverBatched(
+        const float   epsilon,
+        const int32_t max_num_iterations,
+        const int32_t max_stagnation
+    )
+        :m_policy        { epsilon, max_num_iterations, max_stagnation }
+        ,m_num_lanes     { 0 }
+        ,m_dim           { 0 }
+        ,m_omega         { 1.0f }
+        ,m_lane_policies ( NUM_LANES, m_policy )
+    {
+        m_lane_errors.fill( 0.0f );
+        m_lane_iterations.fill( 0 );
+        m_lane_status.fill( MLCPConvergencePolicy<float>::Continue );
+    }
+
+    ~MLCPSolverBatched()
+    {
+    }
+
+    // The lanes from 0 to num_lanes - 1 are used. dim is the largest dim of them.
+    void prepare( const int32_t num_lanes, const int32_t dim )
+    {
+        m_num_lanes = num_lanes;
+        m_dim       = dim;
+
+        m_M.fill   ( 0.0f );
+        m_q.fill   ( 0.0f );
+        m_z.fill   ( 0.0f );
+        m_z_lo.fill( 0.0f );
+        m_z_hi.fill( 0.0f );
+
+        m_lane_errors.fill( 0.0f );
+        m_lane_iterations.fill( 0 );
+        m_lane_status.fill( MLCPConvergencePolicy<float>::Continue );
+    }
+
+    Lane lane( const int32_t l )
+    {
+        return Lane( *this, l );
+    }
+
+    void setNoLimits( const int32_t l, const int32_t i )
+    {
+        m_z_lo[ i * NUM_LANES + l ] = -1.0f * std::numeric_limits<float>::max();
+        m_z_hi[ i * NUM_LANES + l ] = std::numeric_limits<float>::max();
+    }
+
+    void setUnilateralLimits( const int32_t l, const int32_t i )
+    {
+        m_z_lo[ i * NUM_LANES + l ] = 0.0f;
+        m_z_hi[ i * NUM_LANES + l ] = std::numeric_limits<float>::max();
+    }
+
+    void setLimits( const int32_t l, const int32_t i, const float lo, const float hi )
+    {
+        m_z_lo[ i * NUM_LANES + l ] = lo;
+        m_z_hi[ i * NUM_LANES + l ] = hi;
+    }
+
+    // Fixed over-relaxation factor of all the lanes. 0 < omega < 2.
+    void setRelaxation( const float omega )
+    {
+        m_omega = omega;
+    }
+
+    void setM( const int32_t l, const int32_t i, const int32_t j, const float v )
+    {
+        m_M[ ( i * N + j ) * NUM_LANES + l ] = v;
+    }
+
+    void setQ( const int32_t l, const int32_t i, const float v )
+    {
+        m_q[ i * NUM_LANES + l ] = v;
+    }
+
+    // Initial value for warm starting. It must be within the limits.
+    void setInitialZ( const int32_t l, const int32_t i, const float v )
+    {
+        m_z[ i * NUM_LANES + l ] = v;
+    }
+
+    void run()
+    {
+        for ( int32_t i = 0; i < N * NUM_LANES; i++ ) {
+
+            const float diag = m_M[ ( i / NUM_LANES ) * ( N + 1 ) * NUM_LANES + i % NUM_LANES ];
+
+            m_step[ i ]        = ( diag > 0.0f ) ? m_omega / diag : 0.0f;
+            m_error_scale[ i ] = diag / m_omega;
+        }
+
+        for ( int32_t l = m_num_lanes; l < NUM_LANES; l++ ) {
+
+            maskLane( l );
+        }
+
+        calcW();
+
+        for ( int32_t l = 0; l < m_num_lanes; l++ ) {
+
+            m_lane_policies[ l ] = m_policy;
+            m_lane_policies[ l ].start();
+        }
+
+        int32_t num_running = m_num_lanes;
+
+        for ( int32_t iteration = 0; num_running > 0; iteration++ ) {
+
+            sweep();
+
+            for ( int32_t l = 0; l < m_num_lanes; l++ ) {
+
+                if ( m_lane_status[ l ] != MLCPConvergencePolicy<float>::Continue ) {
+                    continue;
+                }
+
+                if ( m_lane_policies[ l ].isCheckIteration( iteration ) ) {
+                    m_lane_errors[ l ] = m_sweep_errors[ l ];
+                }
+
+                m_lane_status[ l ]     = m_lane_policies[ l ].update( iteration, m_sweep_errors[ l ] );
+                m_lane_iterations[ l ] = iteration + 1;
+
+                if ( m_lane_status[ l ] != MLCPConvergencePolicy<float>::Continue ) {
+
+                    maskLane( l );
+                    num_running--;
+                }
+            }
+        }
+    }
+
+    float getZ( const int32_t l, const int32_t i ) const
+    {
+        return m_z[ i * NUM_LANES + l ];
+    }
+
+    float getError( const int32_t l ) const
+    {
+        return m_lane_errors[ l ];
+    }
+
+    int32_t getIterations( const int32_t l ) const
+    {
+        return m_lane_iterations[ l ];
+    }
+
+    typename MLCPConvergencePolicy<float>::Status getStatus( const int32_t l ) const
+    {
+        return m_lane_status[ l ];
+    }
+
+    // Copied to each lane at the beginning of run().
+    MLCPConvergencePolicy<float>& convergencePolicy()
+    {
+        return m_policy;
+    }
+
+private:
+
+    // w = M z + q
+    void calcW()
+    {
+        for ( int32_t row = 0; row < N; row++ ) {
+
+            Float8 dot = Float8::load( &m_q[ row * NUM_LANES ] );
+
+            for ( int32_t col = 0; col < N; col++ ) {
+
+                dot = Float8::fma(
+                    Float8::load( &m_M[ ( row * N + col ) * NUM_LANES ] ),
+                    Float8::load( &m_z[ col * NUM_LANES ] ),
+                    dot
+                );
+            }
+            dot.store( &m_w[ row * NUM_LANES ] );
+        }
+    }
+
+    void sweep()
+    {
+        Float8 error = Float8::zero();
+
+        for ( int32_t row = 0; row < m_dim; row++ ) {
+
+            const auto   off    = row * NUM_LANES;
+            const Float8 z_prev = Float8::load( &m_z[ off ] );
+
+            const Float8 z = Float8::min(
+                Float8::max(
+                    z_prev - Float8::load( &m_w[ off ] ) * Float8::load( &m_step[ off ] ),
+                    Float8::load( &m_z_lo[ off ] )
+                ),
+                Float8::load( &m_z_hi[ off ] )
+            );
+            z.store( &m_z[ off ] );
+
+            const Float8 dz = z - z_prev;
+
+            if ( dz.isZero() ) {
+                continue;
+            }
+
+            error = Float8::fma( dz.abs(), Float8::load( &m_error_scale[ off ] ), error );
+
+            // M is symmetric. The column row is the row row.
+            const float* m = &m_M[ row * N * NUM_LANES ];
+
+#pragma GCC unroll 16
+            for ( int32_t i = 0; i < N; i++ ) {
+
+                Float8::fma(
+                    Float8::load( &m[ i * NUM_LANES ] ),
+                    dz,
+                    Float8::load( &m_w[ i * NUM_LANES ] )
+                ).store( &m_w[ i * NUM_LANES ] );
+            }
+        }
+
+        error.store( m_sweep_errors.data() );
+    }
+
+    // Stops the lane l by the step 0 in all the rows.
+    void maskLane( const int32_t l )
+    {
+        for ( int32_t row = 0; row < N; row++ ) {
+
+            m_step[ row * NUM_LANES + l ] = 0.0f;
+        }
+    }
+
+    MLCPConvergencePolicy<float>
+                                     m_policy;
+    int32_t                          m_num_lanes;
+    int32_t                          m_dim;
+    float                            m_omega;
+
+    std::array<float, N * N * NUM_LANES>
+                                     m_M;
+    std::array<float, N * NUM_LANES> m_q;
+    std::array<float, N * NUM_LANES> m_z;
+    std::array<float, N * NUM_LANES> m_z_lo;
+    std::array<float, N * NUM_LANES> m_z_hi;
+    std::array<float, N * NUM_LANES> m_w;
+    std::array<float, N * NUM_LANES> m_step;
+    std::array<float, N * NUM_LANES> m_error_scale;
+
+    std::vector< MLCPConvergencePolicy<float> >
+                                     m_lane_policies;
+    std::array<float, NUM_LANES>     m_sweep_errors;
+    std::array<float, NUM_LANES>     m_lane_errors;
+    std::array<int32_t, NUM_LANES>   m_lane_iterations;
+    std::array< typename MLCPConvergencePolicy<float>::Status, NUM_LANES >
+                                     m_lane_status;
+};
+
+#endif /*__MLCP_SOLVER_BATCHED_HPP__*/
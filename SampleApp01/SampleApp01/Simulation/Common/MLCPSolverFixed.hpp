@@ -0,0 +1,342 @@
+#ifndef __MLCP_SOLVER_FIXED_HPP__
+#define __MLCP_SOLVER_FIXED_HPP__
+
+#include <array>
+#include <limits>
+#include <algorithm>
+#include <cmath>
+
+#include "MLCPConvergencePolicy.hpp"
+#include "SIMDFloat8.hpp"
+
+template<class T, int32_t N>
+class MLCPSolverFixed {
+
+    // MLCPSolverVanillaPGS for the small problems of dim <= N.
+    //
+    // M, q, z and the limits are kept densely in the arrays of the compile-time
+    // size N inside the object, so that nothing is allocated per solve, and
+    // the loops over the columns have the constant trip count N and are
+    // unrolled. The rows and the columns from dim to N are padded with 0.
+    //
+    // Instead of the row dots, w = M z + q is kept up to date. Relaxing the
+    // row i reads w_i, and adds the column i of M times the change of z_i to w,
+    //
+    //   w += M_{:,i} dz_i,
+    //
+    // which has no dependency chain of the row dot, and is one or two Float8
+    // FMAs for N = 8 and 16 in float. M is symmetric, so the column i is the
+    // row i in the memory. omega / M_ii and M_ii / omega are taken once per
+    // run(), so that no division is left in the sweeps.
+    //
+    // With setDirectRows(n), the first n rows are solved as a block in each
+    // iteration with the dense LDL^T of M_BB, as in MLCPSolverVanillaPGS.
+    // setRelaxation() sets a fixed over-relaxation factor.
+
+public:
+
+    static_assert( N > 0 && N <= 16, "for the small problems only" );
+
+    static constexpr int32_t MAX_DIM = N;
+
+    MLCPSolverFixed(
+        const T       epsilon,
+        const int32_t max_num_iterations,
+        const int32_t max_stagnation
+    )
+        :m_policy     { epsilon, max_num_iterations, max_stagnation }
+        ,m_error      { 0.0 }
+        ,m_dim        { 0 }
+        ,m_dim_direct { 0 }
+        ,m_omega      { 1.0 }
+        ,m_iterations { 0 }
+        ,m_status     { MLCPConvergencePolicy<T>::Continue }
+    {
+        static_assert(    std::is_same< float, T >::value
+                       || std::is_same< double,T >::value );
+    }
+
+    ~MLCPSolverFixed()
+    {
+    }
+
+    void prepare( const int32_t dim )
+    {
+        m_dim        = dim;
+        m_dim_direct = 0;
+        m_error      = 0.0;
+        m_iterations = 0;
+        m_status     = MLCPConvergencePolicy<T>::Continue;
+
+        m_M.fill   ( 0.0 );
+        m_q.fill   ( 0.0 );
+        m_z.fill   ( 0.0 );
+        m_z_lo.fill( 0.0 );
+        m_z_hi.fill( 0.0 );
+    }
+
+    void setNoLimits( const int32_t i )
+    {
+        m_z_lo[i] = -1.0 * std::numeric_limits<T>::max();
+        m_z_hi[i] = std::numeric_limits<T>::max();
+    }
+
+    void setUnilateralLimits( const int32_t i )
+    {
+        m_z_lo[i] = 0.0;
+        m_z_hi[i] = std::numeric_limits<T>::max();
+    }
+
+    void setLimits( const int32_t i, const T lo, const T hi )
+    {
+        m_z_lo[i] = lo;
+        m_z_hi[i] = hi;
+    }
+
+    // Fixed over-relaxation factor. 0 < omega < 2.
+    void setRelaxation( const T omega )
+    {
+        m_omega = omega;
+    }
+
+    // Solves the first dim_direct rows directly. They must have no limits.
+    void setDirectRows( const int32_t dim_direct )
+    {
+        m_dim_direct = dim_direct;
+    }
+
+    void setM( const int32_t i, const int32_t j, const T v )
+    {
+        m_M[ i * N + j ] = v;
+    }
+
+    void setQ( const int32_t i, const T v )
+    {
+        m_q[ i ] = v;
+    }
+
+    // Initial value for warm starting. It must be within the limits.
+    void setInitialZ( const int32_t i, const T v )
+    {
+        m_z[ i ] = v;
+    }
+
+    void run()
+    {
+        if ( m_dim_direct > 0 ) {
+
+            factorizeDirectRows();
+        }
+
+        for ( int32_t row = 0; row < m_dim; row++ ) {
+
+            m_step[ row ]        = m_omega / m_M[ row * N + row ];
+            m_error_scale[ row ] = m_M[ row * N + row ] / m_omega;
+        }
+
+        calcW();
+
+        m_policy.start();
+        m_status = MLCPConvergencePolicy<T>::Continue;
+
+        for ( m_iterations = 0; m_status == MLCPConvergencePolicy<T>::Continue; m_iterations++ ) {
+
+            T error = ( m_dim_direct > 0 ) ? calcZDirect() : 0.0;
+
+            for ( int32_t row = m_dim_direct; row < m_dim; row++ ) {
+
+                const T z_prev = m_z[ row ];
+
+                m_z[ row ] = clamp( z_prev - m_w[ row ] * m_step[ row ], m_z_lo[ row ], m_z_hi[ row ] );
+
+                const T dz = m_z[ row ] - z_prev;
+
+                if ( dz != 0.0 ) {
+
+                    updateW( row, dz );
+                    error += std::abs( dz ) * m_error_scale[ row ];
+                }
+            }
+
+            if ( m_policy.isCheckIteration( m_iterations ) ) {
+                m_error = error;
+            }
+
+            m_status = m_policy.update( m_iterations, error );
+        }
+    }
+
+    const T getZ( const int32_t i ) const
+    {
+        return m_z[i];
+    }
+
+    T getError() const
+    {
+        return m_error;
+    }
+
+    int32_t getIterations() const
+    {
+        return m_iterations;
+    }
+
+    typename MLCPConvergencePolicy<T>::Status getStatus() const
+    {
+        return m_status;
+    }
+
+    MLCPConvergencePolicy<T>& convergencePolicy()
+    {
+        return m_policy;
+    }
+
+private:
+
+    // w = M z + q
+    void calcW()
+    {
+        for ( int32_t row = 0; row < N; row++ ) {
+
+            const T* m = &m_M[ row * N ];
+
+            T dot = m_q[ row ];
+
+#pragma GCC unroll 16
+            for ( int32_t col = 0; col < N; col++ ) {
+
+                dot += m[ col ] * m_z[ col ];
+            }
+            m_w[ row ] = dot;
+        }
+    }
+
+    // w += M_{:,col} dz, which is the row col of M.
+    void updateW( const int32_t col, const T dz )
+    {
+        const T* m = &m_M[ col * N ];
+
+        if constexpr ( std::is_same< float, T >::value && N % 8 == 0 ) {
+
+            const Float8 dz8 = Float8::broadcast( dz );
+
+            for ( int32_t row = 0; row < N; row += 8 ) {
+
+                Float8::fma( Float8::load( &m[ row ] ), dz8, Float8::load( &m_w[ row ] ) ).store( &m_w[ row ] );
+            }
+        }
+        else {
+
+#pragma GCC unroll 16
+            for ( int32_t row = 0; row < N; row++ ) {
+
+                m_w[ row ] += m[ row ] * dz;
+            }
+        }
+    }
+
+    // M_BB = L D L^T in place of m_L and m_D, with the unit diagonal of L implicit.
+    void factorizeDirectRows()
+    {
+        const auto n = m_dim_direct;
+
+        for ( int32_t j = 0; j < n; j++ ) {
+
+            T d = m_M[ j * N + j ];
+
+            for ( int32_t k = 0; k < j; k++ ) {
+
+                d -= m_L[ j * N + k ] * m_L[ j * N + k ] * m_D[ k ];
+            }
+            m_D[ j ] = d;
+
+            for ( int32_t i = j + 1; i < n; i++ ) {
+
+                T l = m_M[ i * N + j ];
+
+                for ( int32_t k = 0; k < j; k++ ) {
+
+                    l -= m_L[ i * N + k ] * m_L[ j * N + k ] * m_D[ k ];
+                }
+                m_L[ i * N + j ] = l / d;
+            }
+        }
+    }
+
+    // Solves the direct rows as a block and returns the sum of |w_i| before the solve.
+    T calcZDirect()
+    {
+        const auto n = m_dim_direct;
+
+        T error = 0.0;
+
+        for ( int32_t row = 0; row < n; row++ ) {
+
+            m_dz[ row ] = -1.0 * m_w[ row ];
+
+            error += std::abs( m_w[ row ] );
+        }
+
+        for ( int32_t i = 0; i < n; i++ ) {
+
+            for ( int32_t k = 0; k < i; k++ ) {
+
+                m_dz[ i ] -= m_L[ i * N + k ] * m_dz[ k ];
+            }
+        }
+
+        for ( int32_t i = 0; i < n; i++ ) {
+
+            m_dz[ i ] /= m_D[ i ];
+        }
+
+        for ( int32_t i = n - 1; i >= 0; i-- ) {
+
+            for ( int32_t k = i + 1; k < n; k++ ) {
+
+                m_dz[ i ] -= m_L[ k * N + i ] * m_dz[ k ];
+            }
+        }
+
+        for ( int32_t i = 0; i < n; i++ ) {
+
+            m_z[ i ] += m_dz[ i ];
+            updateW( i, m_dz[ i ] );
+        }
+
+        return error;
+    }
+
+    T clamp( const T val, const T lo, const T hi ) const
+    {
+        return std::min ( std::max ( val, lo ), hi );
+    }
+
+    MLCPConvergencePolicy<T>
+                         m_policy;
+    T                    m_error; // of the last check iteration.
+
+    int32_t              m_dim;
+    int32_t              m_dim_direct;
+    T                    m_omega;
+
+    std::array<T, N * N> m_M;
+    std::array<T, N>     m_q;
+    std::array<T, N>     m_z;
+    std::array<T, N>     m_z_lo;
+    std::array<T, N>     m_z_hi;
+    std::array<T, N>     m_w;
+    std::array<T, N>     m_step;
+    std::array<T, N>     m_error_scale;
+
+    // direct rows
+    std::array<T, N * N> m_L;
+    std::array<T, N>     m_D;
+    std::array<T, N>     m_dz;
+
+    int32_t              m_iterations;
+    typename MLCPConvergencePolicy<T>::Status
+                         m_status;
+};
+
+#endif /*__MLCP_SOLVER_FIXED_HPP__*/
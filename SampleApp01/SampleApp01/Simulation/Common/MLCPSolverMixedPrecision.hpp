@@ -0,0 +1,311 @@
+#ifndef __MLCP_SOLVER_MIXED_PRECISION_HPP__
+#define __MLCP_SOLVER_MIXED_PRECISION_HPP__
+
+#include <vector>
+#include <limits>
+#include <algorithm>
+#include <cmath>
+
+#include "SparseMatrixCSR.hpp"
+#include "MLCPSolverVanillaPGS.hpp"
+#include "MLCPConvergencePolicy.hpp"
+
+template<class T>
+class MLCPSolverMixedPrecision {
+
+    // Solves the same problem as MLCPSolverVanillaPGS in T (double) with the
+    // iterative refinement around the PGS in float.
+    //
+    //   r       = M z^k + q                        in T
+    //   find d s.t. M d + r = w, lo - z^k <= d <= hi - z^k, and the
+    //   complementarity of the shifted limits     in float
+    //   z^{k+1} = z^k + d                          in T
+    //
+    // Each pass solves the correction only up to the relative tolerance of the
+    // inner convergence policy, which the float sweeps reach quickly, and the
+    // next residual is taken again from M and q in T. The error of z^k shrinks
+    // by about that tolerance per pass down to the T-level, not the float-level,
+    // rounding of M z + q.
+    //
+    // The error given to the (outer) convergence policy is the natural
+    // residual in T as in MLCPSolverAPGD, one per pass. getIterations() returns
+    // the total number of the inner sweeps for the comparison with the other
+    // solvers, and getNumRefinements() the number of the passes.
+    //
+    // setM() must be called row by row in the increasing order of rows,
+    // and only for the non-zero elements.
+
+public:
+
+    static constexpr int32_t DEFAULT_MAX_NUM_REFINEMENTS = 8;
+
+    MLCPSolverMixedPrecision(
+        const T       epsilon,
+        const int32_t max_num_iterations,
+        const int32_t max_stagnation
+    )
+        :m_policy                { epsilon, max_num_iterations, max_stagnation }
+        ,m_inner_policy          { 0.0f, max_num_iterations, max_stagnation }
+        ,m_max_num_refinements   { DEFAULT_MAX_NUM_REFINEMENTS }
+        ,m_inner                 { 0.0f, 0, 0 }
+        ,m_dim                   { 0 }
+        ,m_dim_direct            { 0 }
+        ,m_nncg                  { false }
+        ,m_omega                 { 1.0f }
+        ,m_adaptive_relaxation   { false }
+        ,m_num_refinements       { 0 }
+        ,m_iterations            { 0 }
+        ,m_status                { MLCPConvergencePolicy<T>::Continue }
+    {
+        static_assert(    std::is_same< float, T >::value
+                       || std::is_same< double,T >::value );
+
+        m_inner_policy.setRelativeTolerance( 1.0e-3f );
+    }
+
+    ~MLCPSolverMixedPrecision()
+    {
+    }
+
+    void prepare( const int32_t dim )
+    {
+        m_dim = dim;
+        m_error_history.clear();
+        m_num_refinements = 0;
+        m_iterations      = 0;
+        m_dim_direct      = 0;
+        m_status          = MLCPConvergencePolicy<T>::Continue;
+
+        m_M.reset( dim );
+
+        m_q.assign   ( dim, 0.0 );
+        m_z.assign   ( dim, 0.0 );
+        m_z_lo.assign( dim, 0.0 );
+        m_z_hi.assign( dim, 0.0 );
+        m_r.assign   ( dim, 0.0 );
+    }
+
+    void setNoLimits( const int32_t i )
+    {
+        m_z_lo[i] = -1.0 * std::numeric_limits<T>::max();
+        m_z_hi[i] = std::numeric_limits<T>::max();
+    }
+
+    void setUnilateralLimits( const int32_t i )
+    {
+        m_z_lo[i] = 0.0;
+        m_z_hi[i] = std::numeric_limits<T>::max();
+    }
+
+    void setLimits( const int32_t i, const T lo, const T hi )
+    {
+        m_z_lo[i] = lo;
+        m_z_hi[i] = hi;
+    }
+
+    void setMaxNumRefinements( const int32_t n )
+    {
+        m_max_num_refinements = n;
+    }
+
+    // The options of the inner PGS. See MLCPSolverVanillaPGS.
+    void setDirectRows( const int32_t dim_direct )
+    {
+        m_dim_direct = dim_direct;
+    }
+
+    void setNNCG( const bool nncg )
+    {
+        m_nncg = nncg;
+    }
+
+    void setRelaxation( const float omega )
+    {
+        m_omega = omega;
+    }
+
+    void setAdaptiveRelaxation( const bool adaptive )
+    {
+        m_adaptive_relaxation = adaptive;
+    }
+
+    void setM( const int32_t i, const int32_t j, const T v )
+    {
+        m_M.append( i, j, v );
+    }
+
+    void setQ( const int32_t i, const T v )
+    {
+        m_q[ i ] = v;
+    }
+
+    // Initial value for warm starting. It must be within the limits.
+    void setInitialZ( const int32_t i, const T v )
+    {
+        m_z[ i ] = v;
+    }
+
+    void run()
+    {
+        m_M.finish();
+
+        m_policy.start();
+        m_status = MLCPConvergencePolicy<T>::Continue;
+
+        for ( m_num_refinements = 0; ; m_num_refinements++ ) {
+
+            const T error = calcResidual();
+
+            m_error_history.push_back( error );
+
+            m_status = m_policy.update( m_num_refinements, error );
+
+            if (    m_status == MLCPConvergencePolicy<T>::Continue
+                 && m_num_refinements >= m_max_num_refinements
+            ) {
+                m_status = MLCPConvergencePolicy<T>::MaxIterations;
+            }
+
+            // the last pass is not followed by its solve, so that the error is of the final z.
+            if ( m_status != MLCPConvergencePolicy<T>::Continue ) {
+                break;
+            }
+
+            solveCorrection();
+        }
+    }
+
+    const T getZ( const int32_t i ) const
+    {
+        return m_z[i];
+    }
+
+    T getError() const
+    {
+        if ( m_error_history.empty() ) {
+            return 0.0;
+        }
+        return *m_error_history.rbegin();
+    }
+
+    int32_t getIterations() const
+    {
+        return m_iterations;
+    }
+
+    int32_t getNumRefinements() const
+    {
+        return m_num_refinements;
+    }
+
+    typename MLCPConvergencePolicy<T>::Status getStatus() const
+    {
+        return m_status;
+    }
+
+    // The policy on the error of each pass. The number of the passes is
+    // capped also by setMaxNumRefinements().
+    MLCPConvergencePolicy<T>& convergencePolicy()
+    {
+        return m_policy;
+    }
+
+    // The policy of each inner solve. The relative tolerance is 1e-3 by default.
+    MLCPConvergencePolicy<float>& innerConvergencePolicy()
+    {
+        return m_inner_policy;
+    }
+
+private:
+
+    // r = M z + q, and returns the sum of | z_i - clamp( z_i - r_i / M_ii ) | * M_ii.
+    T calcResidual()
+    {
+        T error = 0.0;
+
+        for ( int32_t i = 0; i < m_dim; i++ ) {
+
+            m_r[ i ] = m_M.rowDot( i, m_z.data() ) + m_q[ i ];
+
+            const T diag = m_M.diagonal( i );
+
+            error += std::abs( m_z[ i ] - clamp( m_z[ i ] - m_r[ i ] / diag, m_z_lo[ i ], m_z_hi[ i ] ) ) * diag;
+        }
+        return error;
+    }
+
+    void solveCorrection()
+    {
+        m_inner.prepare( m_dim, MLCPSolverVanillaPGS<float>::Sparse );
+        m_inner.convergencePolicy() = m_inner_policy;
+        m_inner.setDirectRows( m_dim_direct );
+        m_inner.setNNCG( m_nncg );
+        m_inner.setRelaxation( m_omega );
+        m_inner.setAdaptiveRelaxation( m_adaptive_relaxation );
+
+        for ( int32_t i = 0; i < m_dim; i++ ) {
+
+            for ( int32_t k = m_M.rowBegin( i ); k < m_M.rowEnd( i ); k++ ) {
+
+                m_inner.setM( i, m_M.col( k ), (float)m_M.val( k ) );
+            }
+
+            m_inner.setQ( i, (float)m_r[ i ] );
+            m_inner.setLimits( i, toFloatLimit( m_z_lo[ i ] - m_z[ i ] ), toFloatLimit( m_z_hi[ i ] - m_z[ i ] ) );
+            m_inner.setInitialZ( i, 0.0f );
+        }
+
+        m_inner.run();
+
+        m_iterations += m_inner.getIterations();
+
+        for ( int32_t i = 0; i < m_dim; i++ ) {
+
+            m_z[ i ] = clamp( m_z[ i ] + m_inner.getZ( i ), m_z_lo[ i ], m_z_hi[ i ] );
+        }
+    }
+
+    // The infinite limits of T stay infinite in float.
+    static float toFloatLimit( const T v )
+    {
+        return (float)std::min(
+            std::max( v, (T)( -1.0 * std::numeric_limits<float>::max() ) ),
+            (T)std::numeric_limits<float>::max()
+        );
+    }
+
+    T clamp( const T val, const T lo, const T hi ) const
+    {
+        return std::min ( std::max ( val, lo ), hi );
+    }
+
+    MLCPConvergencePolicy<T>
+                         m_policy;
+    MLCPConvergencePolicy<float>
+                         m_inner_policy;
+    int32_t              m_max_num_refinements;
+    std::vector<T>       m_error_history;
+
+    MLCPSolverVanillaPGS<float>
+                         m_inner;
+
+    int32_t              m_dim;
+    SparseMatrixCSR<T>   m_M;
+    std::vector<T>       m_q;
+    std::vector<T>       m_z;
+    std::vector<T>       m_z_lo;
+    std::vector<T>       m_z_hi;
+    std::vector<T>       m_r;
+
+    int32_t              m_dim_direct;
+    bool                 m_nncg;
+    float                m_omega;
+    bool                 m_adaptive_relaxation;
+
+    int32_t              m_num_refinements;
+    int32_t              m_iterations;
+    typename MLCPConvergencePolicy<T>::Status
+                         m_status;
+};
+
+#endif /*__MLCP_SOLVER_MIXED_PRECISION_HPP__*/
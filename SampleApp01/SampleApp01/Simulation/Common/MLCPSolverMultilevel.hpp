@@ -0,0 +1,596 @@
+#ifndef __MLCP_SOLVER_MULTILEVEL_HPP__
+#define __MLCP_SOLVER_MULTILEVEL_HPP__
+
+#include <vector>
+#include <limits>
+#include <algorithm>
+#include <cmath>
+
+#include "SparseMatrixCSR.hpp"
+#include "SparseLDLT.hpp"
+#include "MLCPConvergencePolicy.hpp"
+
+template<class T>
+class MLCPSolverMultilevel {
+
+    // Solves the same problem as MLCPSolverVanillaPGS with the aggregation
+    // multigrid around the PGS.
+    //
+    // A PGS sweep propagates a correction only to the neighboring rows, so the
+    // smooth errors along a chain or a stack decay slowly. The rows are paired
+    // with their most strongly coupled neighbors level by level
+    //
+    //   M_{l+1} = P_l^T M_l P_l,
+    //
+    // where P_l maps a coarse row to its one or two fine rows with the signs
+    // that make the pair move together, i.e., s_i s_j M_ij < 0.
+    // The coarsest level (COARSEST_DIM rows or less) is factorized with SparseLDLT.
+    //
+    // An iteration is a V-cycle:
+    //
+    //   1. num_smoothing PGS sweeps on the fine level. The error of the
+    //      first one is given to the convergence policy.
+    //   2. The residual is restricted, with the rows at their limits excluded
+    //      (truncation), and the unconstrained coarse problem is solved
+    //      approximately by a V-cycle with Gauss-Seidel smoothing.
+    //   3. The prolongated correction d is taken as clamp( z + alpha* d ) with
+    //      the exact line search step alpha*, if it decreases the energy
+    //      1/2 z^T M z + q^T z, and otherwise with the largest feasible step
+    //      up to alpha*, which always does. The cycle is monotone like the PGS.
+    //   4. num_smoothing PGS sweeps on the fine level.
+    //
+    // All the steps are linear in the number of the non-zeros of M.
+    // setM() must be called row by row in the increasing order of rows,
+    // and only for the non-zero elements.
+
+public:
+
+    static constexpr int32_t COARSEST_DIM = 32;
+
+    MLCPSolverMultilevel(
+        const T       epsilon,
+        const int32_t max_num_iterations,
+        const int32_t max_stagnation
+    )
+        :m_policy        { epsilon, max_num_iterations, max_stagnation }
+        ,m_num_smoothing { 2 }
+        ,m_num_levels    { 0 }
+        ,m_dim           { 0 }
+        ,m_iterations    { 0 }
+        ,m_status        { MLCPConvergencePolicy<T>::Continue }
+    {
+        static_assert(    std::is_same< float, T >::value
+                       || std::is_same< double,T >::value );
+    }
+
+    ~MLCPSolverMultilevel()
+    {
+    }
+
+    // The number of the PGS sweeps before and after the coarse correction.
+    // At least one sweep is taken before it.
+    void setNumSmoothingSweeps( const int32_t n )
+    {
+        m_num_smoothing = n;
+    }
+
+    void prepare( const int32_t dim )
+    {
+        m_dim = dim;
+        m_error_history.clear();
+        m_iterations = 0;
+        m_status     = MLCPConvergencePolicy<T>::Continue;
+
+        if ( m_levels.empty() ) {
+            m_levels.emplace_back();
+        }
+        m_levels[ 0 ].m_M.reset( dim );
+
+        m_q.assign   ( dim, 0.0 );
+        m_z.assign   ( dim, 0.0 );
+        m_z_lo.assign( dim, 0.0 );
+        m_z_hi.assign( dim, 0.0 );
+        m_g.assign   ( dim, 0.0 );
+        m_d.assign   ( dim, 0.0 );
+        m_Md.assign  ( dim, 0.0 );
+        m_z_try.assign( dim, 0.0 );
+    }
+
+    void setNoLimits( const int32_t i )
+    {
+        m_z_lo[i] = -1.0 * std::numeric_limits<T>::max();
+        m_z_hi[i] = std::numeric_limits<T>::max();
+    }
+
+    void setUnilateralLimits( const int32_t i )
+    {
+        m_z_lo[i] = 0.0;
+        m_z_hi[i] = std::numeric_limits<T>::max();
+    }
+
+    void setLimits( const int32_t i, const T lo, const T hi )
+    {
+        m_z_lo[i] = lo;
+        m_z_hi[i] = hi;
+    }
+
+    void setM( const int32_t i, const int32_t j, const T v )
+    {
+        m_levels[ 0 ].m_M.append( i, j, v );
+    }
+
+    void setQ( const int32_t i, const T v )
+    {
+        m_q[ i ] = v;
+    }
+
+    // Initial value for warm starting. It must be within the limits.
+    void setInitialZ( const int32_t i, const T v )
+    {
+        m_z[ i ] = v;
+    }
+
+    void run()
+    {
+        m_levels[ 0 ].m_M.finish();
+
+        buildLevels();
+
+        m_policy.start();
+        m_status = MLCPConvergencePolicy<T>::Continue;
+
+        for ( m_iterations = 0; m_status == MLCPConvergencePolicy<T>::Continue; m_iterations++ ) {
+
+            // The error of the first sweep measures the z from the previous cycle,
+            // as in MLCPSolverVanillaPGS.
+            const T error = sweep();
+
+            for ( int32_t k = 1; k < m_num_smoothing; k++ ) {
+                sweep();
+            }
+
+            if ( m_num_levels > 1 ) {
+                correctFromCoarseLevels();
+            }
+
+            for ( int32_t k = 0; k < m_num_smoothing; k++ ) {
+                sweep();
+            }
+
+            if ( m_policy.isCheckIteration( m_iterations ) ) {
+                m_error_history.push_back( error );
+            }
+
+            m_status = m_policy.update( m_iterations, error );
+        }
+    }
+
+    const T getZ( const int32_t i ) const
+    {
+        return m_z[i];
+    }
+
+    T getError() const
+    {
+        if ( m_error_history.empty() ) {
+            return 0.0;
+        }
+        return *m_error_history.rbegin();
+    }
+
+    // The number of the V-cycles.
+    int32_t getIterations() const
+    {
+        return m_iterations;
+    }
+
+    int32_t getNumLevels() const
+    {
+        return m_num_levels;
+    }
+
+    typename MLCPConvergencePolicy<T>::Status getStatus() const
+    {
+        return m_status;
+    }
+
+    MLCPConvergencePolicy<T>& convergencePolicy()
+    {
+        return m_policy;
+    }
+
+private:
+
+    struct Level {
+
+        SparseMatrixCSR<T>   m_M;
+
+        // to the next coarser level
+        std::vector<int32_t> m_aggregate;     // fine row -> coarse row
+        std::vector<T>       m_sign;          // fine row -> +1 or -1
+        std::vector<int32_t> m_members_begin; // coarse row -> fine rows
+        std::vector<int32_t> m_members;
+
+        // right hand side and solution of the correction equation M e = r.
+        std::vector<T>       m_r;
+        std::vector<T>       m_e;
+    };
+
+    void buildLevels()
+    {
+        m_num_levels = 1;
+
+        while ( m_levels[ m_num_levels - 1 ].m_M.dim() > COARSEST_DIM ) {
+
+            if ( (int32_t)m_levels.size() == m_num_levels ) {
+                m_levels.emplace_back();
+            }
+
+            auto& fine   = m_levels[ m_num_levels - 1 ];
+            auto& coarse = m_levels[ m_num_levels ];
+
+            const auto dim_coarse = aggregate( fine );
+
+            // no more coupled pairs.
+            if ( dim_coarse == fine.m_M.dim() ) {
+                break;
+            }
+
+            buildCoarseMatrix( fine, coarse, dim_coarse );
+
+            m_num_levels++;
+        }
+
+        for ( int32_t l = 1; l < m_num_levels; l++ ) {
+
+            const auto dim = m_levels[ l ].m_M.dim();
+
+            m_levels[ l ].m_r.resize( dim );
+            m_levels[ l ].m_e.resize( dim );
+        }
+
+        if ( m_num_levels > 1 ) {
+
+            const auto& coarsest = m_levels[ m_num_levels - 1 ].m_M;
+
+            m_coarsest_ldlt.reset( coarsest.dim() );
+
+            for ( int32_t i = 0; i < coarsest.dim(); i++ ) {
+                for ( int32_t k = coarsest.rowBegin( i ); k < coarsest.rowEnd( i ); k++ ) {
+                    m_coarsest_ldlt.append( i, coarsest.col( k ), coarsest.val( k ) );
+                }
+            }
+            m_coarsest_ldlt.factorize();
+        }
+    }
+
+    // Pairs each row with the unpaired neighbor of the strongest coupling
+    // |M_ij| / sqrt( M_ii M_jj ). Returns the number of the coarse rows.
+    int32_t aggregate( Level& fine )
+    {
+        const auto& M   = fine.m_M;
+        const auto  dim = M.dim();
+
+        fine.m_aggregate.assign( dim, -1 );
+        fine.m_sign.assign( dim, 1.0 );
+        fine.m_members_begin.clear();
+        fine.m_members.clear();
+
+        int32_t dim_coarse = 0;
+
+        for ( int32_t i = 0; i < dim; i++ ) {
+
+            if ( fine.m_aggregate[ i ] >= 0 ) {
+                continue;
+            }
+
+            int32_t best_j        = -1;
+            T       best_strength = 0.0;
+
+            for ( int32_t k = M.rowBegin( i ); k < M.rowEnd( i ); k++ ) {
+
+                const auto j = M.col( k );
+
+                if ( j == i || fine.m_aggregate[ j ] >= 0 ) {
+                    continue;
+                }
+
+                const T strength = std::abs( M.val( k ) ) / std::sqrt( M.diagonal( i ) * M.diagonal( j ) );
+
+                if ( strength > best_strength ) {
+                    best_strength = strength;
+                    best_j        = j;
+                }
+            }
+
+            fine.m_members_begin.push_back( (int32_t)fine.m_members.size() );
+
+            fine.m_aggregate[ i ] = dim_coarse;
+            fine.m_members.push_back( i );
+
+            if ( best_j >= 0 ) {
+
+                fine.m_aggregate[ best_j ] = dim_coarse;
+                fine.m_sign[ best_j ]      = ( coefficient( M, i, best_j ) > 0.0 ) ? -1.0 : 1.0;
+                fine.m_members.push_back( best_j );
+            }
+
+            dim_coarse++;
+        }
+        fine.m_members_begin.push_back( (int32_t)fine.m_members.size() );
+
+        return dim_coarse;
+    }
+
+    T coefficient( const SparseMatrixCSR<T>& M, const int32_t i, const int32_t j ) const
+    {
+        for ( int32_t k = M.rowBegin( i ); k < M.rowEnd( i ); k++ ) {
+
+            if ( M.col( k ) == j ) {
+                return M.val( k );
+            }
+        }
+        return 0.0;
+    }
+
+    // M_c[I][J] = sum_{i in I, j in J} s_i s_j M_ij, row by row.
+    void buildCoarseMatrix( const Level& fine, Level& coarse, const int32_t dim_coarse )
+    {
+        const auto& M = fine.m_M;
+
+        coarse.m_M.reset( dim_coarse );
+
+        m_row_marker.assign( dim_coarse, -1 );
+        m_row_vals.resize( dim_coarse );
+
+        for ( int32_t I = 0; I < dim_coarse; I++ ) {
+
+            m_row_cols.clear();
+
+            for ( int32_t m = fine.m_members_begin[ I ]; m < fine.m_members_begin[ I + 1 ]; m++ ) {
+
+                const auto i = fine.m_members[ m ];
+
+                for ( int32_t k = M.rowBegin( i ); k < M.rowEnd( i ); k++ ) {
+
+                    const auto j = M.col( k );
+                    const auto J = fine.m_aggregate[ j ];
+                    const T    v = fine.m_sign[ i ] * fine.m_sign[ j ] * M.val( k );
+
+                    if ( m_row_marker[ J ] != I ) {
+
+                        m_row_marker[ J ] = I;
+                        m_row_vals[ J ]   = v;
+                        m_row_cols.push_back( J );
+                    }
+                    else {
+                        m_row_vals[ J ] += v;
+                    }
+                }
+            }
+
+            for ( const auto J : m_row_cols ) {
+                coarse.m_M.append( I, J, m_row_vals[ J ] );
+            }
+        }
+
+        coarse.m_M.finish();
+    }
+
+    // Projected Gauss-Seidel on the fine level. Returns the error as in MLCPSolverVanillaPGS.
+    T sweep()
+    {
+        const auto& M = m_levels[ 0 ].m_M;
+
+        T error = 0.0;
+
+        for ( int32_t i = 0; i < m_dim; i++ ) {
+
+            const T diag   = M.diagonal( i );
+            const T z_prev = m_z[ i ];
+
+            m_z[ i ] = clamp( z_prev - ( M.rowDot( i, m_z.data() ) + m_q[ i ] ) / diag, m_z_lo[ i ], m_z_hi[ i ] );
+
+            error += std::abs( m_z[ i ] - z_prev ) * diag;
+        }
+        return error;
+    }
+
+    void correctFromCoarseLevels()
+    {
+        const auto& M     = m_levels[ 0 ].m_M;
+        auto&       first = m_levels[ 0 ];
+
+        // truncated residual r = -( M z + q ), 0 for the rows held at their limits.
+        first.m_r.resize( m_dim );
+
+        for ( int32_t i = 0; i < m_dim; i++ ) {
+
+            m_g[ i ] = M.rowDot( i, m_z.data() ) + m_q[ i ];
+
+            first.m_r[ i ] = isHeldAtLimit( i ) ? 0.0 : -1.0 * m_g[ i ];
+        }
+
+        restrict( 0 );
+
+        solveCoarse( 1 );
+
+        // d = P e, truncated.
+        for ( int32_t i = 0; i < m_dim; i++ ) {
+
+            m_d[ i ] = isHeldAtLimit( i ) ? 0.0 : first.m_sign[ i ] * m_levels[ 1 ].m_e[ first.m_aggregate[ i ] ];
+        }
+
+        T g_d  = 0.0;
+        T d_Md = 0.0;
+
+        for ( int32_t i = 0; i < m_dim; i++ ) {
+
+            m_Md[ i ] = M.rowDot( i, m_d.data() );
+
+            g_d  += m_g[ i ] * m_d[ i ];
+            d_Md += m_d[ i ] * m_Md[ i ];
+        }
+
+        if ( g_d >= 0.0 || d_Md <= 0.0 ) {
+            return;
+        }
+
+        const T alpha = -1.0 * g_d / d_Md;
+
+        // the projected step, accepted if the energy decreases.
+        T diff_energy = 0.0;
+
+        for ( int32_t i = 0; i < m_dim; i++ ) {
+
+            m_z_try[ i ] = clamp( m_z[ i ] + alpha * m_d[ i ], m_z_lo[ i ], m_z_hi[ i ] );
+        }
+        for ( int32_t i = 0; i < m_dim; i++ ) {
+
+            const T dz = m_z_try[ i ] - m_z[ i ];
+
+            if ( dz != 0.0 ) {
+                diff_energy += dz * ( m_g[ i ] + 0.5 * M.rowDot( i, m_z_try.data() ) - 0.5 * M.rowDot( i, m_z.data() ) );
+            }
+        }
+
+        if ( diff_energy < 0.0 ) {
+
+            std::swap( m_z, m_z_try );
+            return;
+        }
+
+        // the largest feasible step along d.
+        T alpha_feasible = alpha;
+
+        for ( int32_t i = 0; i < m_dim; i++ ) {
+
+            if ( m_d[ i ] > 0.0 ) {
+                alpha_feasible = std::min( alpha_feasible, ( m_z_hi[ i ] - m_z[ i ] ) / m_d[ i ] );
+            }
+            else if ( m_d[ i ] < 0.0 ) {
+                alpha_feasible = std::min( alpha_feasible, ( m_z_lo[ i ] - m_z[ i ] ) / m_d[ i ] );
+            }
+        }
+
+        for ( int32_t i = 0; i < m_dim; i++ ) {
+
+            m_z[ i ] = clamp( m_z[ i ] + alpha_feasible * m_d[ i ], m_z_lo[ i ], m_z_hi[ i ] );
+        }
+    }
+
+    // The row at its limit whose w pushes it further out.
+    bool isHeldAtLimit( const int32_t i ) const
+    {
+        return    ( m_z[ i ] <= m_z_lo[ i ] && m_g[ i ] > 0.0 )
+               || ( m_z[ i ] >= m_z_hi[ i ] && m_g[ i ] < 0.0 );
+    }
+
+    // r_{l+1} = P_l^T r_l
+    void restrict( const int32_t l )
+    {
+        const auto& fine   = m_levels[ l ];
+        auto&       coarse = m_levels[ l + 1 ];
+
+        std::fill( coarse.m_r.begin(), coarse.m_r.end(), 0.0 );
+
+        for ( int32_t i = 0; i < fine.m_M.dim(); i++ ) {
+
+            coarse.m_r[ fine.m_aggregate[ i ] ] += fine.m_sign[ i ] * fine.m_r[ i ];
+        }
+    }
+
+    // Solves M_l e_l = r_l approximately by a V-cycle.
+    void solveCoarse( const int32_t l )
+    {
+        auto& level = m_levels[ l ];
+
+        if ( l == m_num_levels - 1 ) {
+
+            level.m_e = level.m_r;
+            m_coarsest_ldlt.solve( level.m_e.data() );
+            return;
+        }
+
+        std::fill( level.m_e.begin(), level.m_e.end(), 0.0 );
+
+        for ( int32_t k = 0; k < m_num_smoothing; k++ ) {
+            smooth( level );
+        }
+
+        // the residual of the correction equation in m_r of the next level, via the work array.
+        m_residual.resize( level.m_M.dim() );
+
+        for ( int32_t i = 0; i < level.m_M.dim(); i++ ) {
+
+            m_residual[ i ] = level.m_r[ i ] - level.m_M.rowDot( i, level.m_e.data() );
+        }
+
+        auto& coarse = m_levels[ l + 1 ];
+
+        std::fill( coarse.m_r.begin(), coarse.m_r.end(), 0.0 );
+
+        for ( int32_t i = 0; i < level.m_M.dim(); i++ ) {
+
+            coarse.m_r[ level.m_aggregate[ i ] ] += level.m_sign[ i ] * m_residual[ i ];
+        }
+
+        solveCoarse( l + 1 );
+
+        for ( int32_t i = 0; i < level.m_M.dim(); i++ ) {
+
+            level.m_e[ i ] += level.m_sign[ i ] * coarse.m_e[ level.m_aggregate[ i ] ];
+        }
+
+        for ( int32_t k = 0; k < m_num_smoothing; k++ ) {
+            smooth( level );
+        }
+    }
+
+    // Unconstrained Gauss-Seidel on M_l e_l = r_l.
+    void smooth( Level& level )
+    {
+        const auto& M = level.m_M;
+
+        for ( int32_t i = 0; i < M.dim(); i++ ) {
+
+            level.m_e[ i ] += ( level.m_r[ i ] - M.rowDot( i, level.m_e.data() ) ) / M.diagonal( i );
+        }
+    }
+
+    T clamp( const T val, const T lo, const T hi ) const
+    {
+        return std::min ( std::max ( val, lo ), hi );
+    }
+
+    MLCPConvergencePolicy<T>
+                         m_policy;
+    std::vector<T>       m_error_history;
+    int32_t              m_num_smoothing;
+
+    std::vector<Level>   m_levels;
+    int32_t              m_num_levels;
+    SparseLDLT<T>        m_coarsest_ldlt;
+
+    int32_t              m_dim;
+    std::vector<T>       m_q;
+    std::vector<T>       m_z;
+    std::vector<T>       m_z_lo;
+    std::vector<T>       m_z_hi;
+
+    // work area
+    std::vector<T>       m_g;
+    std::vector<T>       m_d;
+    std::vector<T>       m_Md;
+    std::vector<T>       m_z_try;
+    std::vector<T>       m_residual;
+    std::vector<int32_t> m_row_marker;
+    std::vector<int32_t> m_row_cols;
+    std::vector<T>       m_row_vals;
+
+    int32_t              m_iterations;
+    typename MLCPConvergencePolicy<T>::Status
+                         m_status;
+};
+
+#endif /*__MLCP_SOLVER_MULTILEVEL_HPP__*/
@@ -0,0 +1,417 @@
+#ifndef __MLCP_SOLVER_PIVOTING_HPP__
+#define __MLCP_SOLVER_PIVOTING_HPP__
+
+#include <vector>
+#include <limits>
+#include <algorithm>
+#include <cmath>
+
+#include "MLCPConvergencePolicy.hpp"
+
+template<class T>
+class MLCPSolverPivoting {
+
+    // Solves the same problem as MLCPSolverVanillaPGS exactly with Dantzig's
+    // principal pivoting method for the box-bounded MLCP [Baraff 1994].
+    //
+    //   M z + q = w,  lo <= z <= hi
+    //
+    //   z_i = lo_i  =>  w_i >= 0
+    //   z_i = hi_i  =>  w_i <= 0
+    //   lo_i < z_i < hi_i  =>  w_i = 0
+    //
+    // The unilateral rows [0, inf) are the LCP that Lemke's method would solve,
+    // and the bilateral rows (-inf, inf) are always in the clamped set.
+    //
+    // The rows are driven to complementarity one by one, starting from z = 0,
+    // hence lo <= 0 <= hi is required, and the initial z is not used.
+    // While a row is driven, the clamped rows C keep w_C = 0, and the pivots
+    // move the rows in and out of C. The inverse of M_CC is updated in O(|C|^2)
+    // by bordering and downdating, and w in O(n|C|), per pivot.
+    // For a PD M the number of pivots is finite, and it is capped at
+    // max_pivots_per_row * n as a safeguard against round-off.
+    //
+    // The pivoting is done in double regardless of T to keep the incrementally
+    // updated inverse accurate. M is dense, as this is meant for small systems.
+
+public:
+
+    MLCPSolverPivoting( const int32_t max_pivots_per_row = 8 )
+        :m_max_pivots_per_row { max_pivots_per_row }
+        ,m_dim                { 0 }
+        ,m_num_clamped        { 0 }
+        ,m_iterations         { 0 }
+        ,m_error              { 0.0 }
+        ,m_status             { MLCPConvergencePolicy<T>::Continue }
+    {
+        static_assert(    std::is_same< float, T >::value
+                       || std::is_same< double,T >::value );
+    }
+
+    ~MLCPSolverPivoting()
+    {
+    }
+
+    void prepare( const int32_t dim )
+    {
+        m_dim        = dim;
+        m_iterations = 0;
+        m_error      = 0.0;
+        m_status     = MLCPConvergencePolicy<T>::Continue;
+
+        m_M.assign   ( dim * dim, 0.0 );
+        m_A.assign   ( dim * dim, 0.0 );
+        m_q.assign   ( dim, 0.0 );
+        m_z.assign   ( dim, 0.0 );
+        m_w.assign   ( dim, 0.0 );
+        m_z_lo.assign( dim, 0.0 );
+        m_z_hi.assign( dim, 0.0 );
+        m_dz.assign  ( dim, 0.0 );
+        m_dw.assign  ( dim, 0.0 );
+        m_u.assign   ( dim, 0.0 );
+        m_state.assign( dim, Unprocessed );
+        m_clamped.assign( dim, -1 );
+    }
+
+    void setNoLimits( const int32_t i )
+    {
+        m_z_lo[i] = -1.0 * std::numeric_limits<double>::max();
+        m_z_hi[i] = std::numeric_limits<double>::max();
+    }
+
+    void setUnilateralLimits( const int32_t i )
+    {
+        m_z_lo[i] = 0.0;
+        m_z_hi[i] = std::numeric_limits<double>::max();
+    }
+
+    // lo <= 0 <= hi.
+    void setLimits( const int32_t i, const T lo, const T hi )
+    {
+        m_z_lo[i] = lo;
+        m_z_hi[i] = hi;
+    }
+
+    void setM( const int32_t i, const int32_t j, const T v )
+    {
+        m_M[ i * m_dim + j ] = v;
+    }
+
+    void setQ( const int32_t i, const T v )
+    {
+        m_q[ i ] = v;
+    }
+
+    // Not used. The pivoting always starts from z = 0.
+    void setInitialZ( const int32_t, const T )
+    {
+    }
+
+    void run()
+    {
+        std::fill( m_z.begin(), m_z.end(), 0.0 );
+        std::copy( m_q.begin(), m_q.end(), m_w.begin() );
+        std::fill( m_state.begin(), m_state.end(), Unprocessed );
+        m_num_clamped = 0;
+        m_iterations  = 0;
+        m_status      = MLCPConvergencePolicy<T>::Converged;
+
+        const int32_t max_pivots = m_max_pivots_per_row * std::max( 1, m_dim );
+
+        for ( int32_t d = 0; d < m_dim; d++ ) {
+
+            if ( !driveRow( d, max_pivots ) ) {
+
+                m_status = MLCPConvergencePolicy<T>::MaxIterations;
+                break;
+            }
+        }
+
+        m_error = calcError();
+    }
+
+    const T getZ( const int32_t i ) const
+    {
+        return m_z[i];
+    }
+
+    // The sum of the natural residuals as in MLCPSolverVanillaPGS.
+    T getError() const
+    {
+        return m_error;
+    }
+
+    // The number of pivots.
+    int32_t getIterations() const
+    {
+        return m_iterations;
+    }
+
+    typename MLCPConvergencePolicy<T>::Status getStatus() const
+    {
+        return m_status;
+    }
+
+private:
+
+    typedef enum _State {
+        Unprocessed,
+        Clamped,
+        AtLower,
+        AtUpper
+    } State;
+
+    // Drives z_d until w_d = 0 or z_d hits a limit, while keeping the other
+    // processed rows complementary. Returns false if the pivots ran out.
+    bool driveRow( const int32_t d, const int32_t max_pivots )
+    {
+        while ( m_iterations < max_pivots ) {
+
+            // Direction of z_d that brings w_d to 0, as dw_d / dz_d = M_dd - M_dC M_CC^-1 M_Cd > 0.
+            const double dir = ( m_w[ d ] < 0.0 ) ? 1.0 : -1.0;
+
+            if ( m_w[ d ] == 0.0 ) {
+                m_state[ d ] = classify( d );
+                if ( m_state[ d ] == Clamped ) {
+                    addClamped( d );
+                }
+                return true;
+            }
+            if ( dir > 0.0 && m_z[ d ] >= m_z_hi[ d ] ) {
+                m_state[ d ] = AtUpper;
+                return true;
+            }
+            if ( dir < 0.0 && m_z[ d ] <= m_z_lo[ d ] ) {
+                m_state[ d ] = AtLower;
+                return true;
+            }
+
+            m_iterations++;
+
+            calcDirection( d, dir );
+
+            // The largest step that keeps all the processed rows complementary.
+            double  step     = -1.0 * m_w[ d ] / m_dw[ d ];
+            int32_t blocking = d;
+            State   next     = Clamped;
+
+            const double to_limit = ( dir > 0.0 ) ? m_z_hi[ d ] - m_z[ d ] : m_z[ d ] - m_z_lo[ d ];
+            if ( to_limit < step ) {
+                step     = to_limit;
+                next     = ( dir > 0.0 ) ? AtUpper : AtLower;
+            }
+
+            for ( int32_t k = 0; k < m_num_clamped; k++ ) {
+
+                const auto   i  = m_clamped[ k ];
+                const double dz = m_dz[ i ];
+
+                if ( dz > 0.0 && ( m_z_hi[ i ] - m_z[ i ] ) / dz < step ) {
+                    step     = ( m_z_hi[ i ] - m_z[ i ] ) / dz;
+                    blocking = i;
+                    next     = AtUpper;
+                }
+                else if ( dz < 0.0 && ( m_z_lo[ i ] - m_z[ i ] ) / dz < step ) {
+                    step     = ( m_z_lo[ i ] - m_z[ i ] ) / dz;
+                    blocking = i;
+                    next     = AtLower;
+                }
+            }
+
+            for ( int32_t i = 0; i < d; i++ ) {
+
+                const double dw = m_dw[ i ];
+
+                if (    ( ( m_state[ i ] == AtLower && dw < 0.0 ) || ( m_state[ i ] == AtUpper && dw > 0.0 ) )
+                     && -1.0 * m_w[ i ] / dw < step
+                ) {
+                    step     = -1.0 * m_w[ i ] / dw;
+                    blocking = i;
+                    next     = Clamped;
+                }
+            }
+
+            step = std::max( 0.0, step );
+
+            m_z[ d ] += step * dir;
+            for ( int32_t k = 0; k < m_num_clamped; k++ ) {
+                m_z[ m_clamped[ k ] ] += step * m_dz[ m_clamped[ k ] ];
+            }
+            for ( int32_t i = 0; i < m_dim; i++ ) {
+                m_w[ i ] += step * m_dw[ i ];
+            }
+
+            if ( blocking == d ) {
+
+                m_state[ d ] = next;
+
+                if ( next == Clamped ) {
+                    m_w[ d ] = 0.0;
+                    addClamped( d );
+                }
+                else {
+                    m_z[ d ] = ( next == AtUpper ) ? m_z_hi[ d ] : m_z_lo[ d ];
+                }
+                return true;
+            }
+
+            if ( next == Clamped ) {
+                m_w[ blocking ] = 0.0;
+                addClamped( blocking );
+            }
+            else {
+                m_z[ blocking ] = ( next == AtUpper ) ? m_z_hi[ blocking ] : m_z_lo[ blocking ];
+                removeClamped( blocking );
+            }
+            m_state[ blocking ] = next;
+        }
+
+        return false;
+    }
+
+    State classify( const int32_t i ) const
+    {
+        if ( m_z[ i ] <= m_z_lo[ i ] ) {
+            return AtLower;
+        }
+        if ( m_z[ i ] >= m_z_hi[ i ] ) {
+            return AtUpper;
+        }
+        return Clamped;
+    }
+
+    // dz_C = - M_CC^-1 M_Cd dir, and dw = M_:C dz_C + M_:d dir.
+    void calcDirection( const int32_t d, const double dir )
+    {
+        for ( int32_t k = 0; k < m_num_clamped; k++ ) {
+
+            double s = 0.0;
+            for ( int32_t l = 0; l < m_num_clamped; l++ ) {
+                s += m_A[ k * m_dim + l ] * m_M[ m_clamped[ l ] * m_dim + d ];
+            }
+            m_dz[ m_clamped[ k ] ] = -1.0 * s * dir;
+        }
+
+        for ( int32_t i = 0; i < m_dim; i++ ) {
+
+            double s = m_M[ i * m_dim + d ] * dir;
+            for ( int32_t k = 0; k < m_num_clamped; k++ ) {
+                s += m_M[ i * m_dim + m_clamped[ k ] ] * m_dz[ m_clamped[ k ] ];
+            }
+            m_dw[ i ] = s;
+        }
+    }
+
+    // Appends j to C, and borders the inverse.
+    //
+    //   [ M_CC  b ]^-1   [ A + u u^T / s   -u / s ]
+    //   [ b^T   c ]    = [ -u^T / s         1 / s ],  u = A b, s = c - b^T u
+    void addClamped( const int32_t j )
+    {
+        const auto k = m_num_clamped;
+
+        double s = m_M[ j * m_dim + j ];
+
+        for ( int32_t l = 0; l < k; l++ ) {
+
+            double u = 0.0;
+            for ( int32_t m = 0; m < k; m++ ) {
+                u += m_A[ l * m_dim + m ] * m_M[ m_clamped[ m ] * m_dim + j ];
+            }
+            m_u[ l ] = u;
+            s -= m_M[ m_clamped[ l ] * m_dim + j ] * u;
+        }
+
+        for ( int32_t l = 0; l < k; l++ ) {
+            for ( int32_t m = 0; m < k; m++ ) {
+                m_A[ l * m_dim + m ] += m_u[ l ] * m_u[ m ] / s;
+            }
+            m_A[ l * m_dim + k ] = -1.0 * m_u[ l ] / s;
+            m_A[ k * m_dim + l ] = -1.0 * m_u[ l ] / s;
+        }
+        m_A[ k * m_dim + k ] = 1.0 / s;
+
+        m_clamped[ k ] = j;
+        m_num_clamped++;
+    }
+
+    // Removes j from C, and downdates the inverse after moving j to the last.
+    //
+    //   A' = E - f f^T / g  for  A = [ E f ; f^T g ]
+    void removeClamped( const int32_t j )
+    {
+        const auto last = m_num_clamped - 1;
+
+        int32_t r = 0;
+        while ( m_clamped[ r ] != j ) {
+            r++;
+        }
+
+        if ( r != last ) {
+
+            std::swap( m_clamped[ r ], m_clamped[ last ] );
+
+            for ( int32_t l = 0; l <= last; l++ ) {
+                std::swap( m_A[ r * m_dim + l ], m_A[ last * m_dim + l ] );
+            }
+            for ( int32_t l = 0; l <= last; l++ ) {
+                std::swap( m_A[ l * m_dim + r ], m_A[ l * m_dim + last ] );
+            }
+        }
+
+        const double g = m_A[ last * m_dim + last ];
+
+        for ( int32_t l = 0; l < last; l++ ) {
+            for ( int32_t m = 0; m < last; m++ ) {
+                m_A[ l * m_dim + m ] -= m_A[ l * m_dim + last ] * m_A[ m * m_dim + last ] / g;
+            }
+        }
+
+        m_num_clamped--;
+    }
+
+    T calcError() const
+    {
+        double error = 0.0;
+
+        for ( int32_t i = 0; i < m_dim; i++ ) {
+
+            double w = m_q[ i ];
+            for ( int32_t j = 0; j < m_dim; j++ ) {
+                w += m_M[ i * m_dim + j ] * m_z[ j ];
+            }
+
+            const double diag = m_M[ i * m_dim + i ];
+            const double z    = std::min( std::max( m_z[ i ] - w / diag, m_z_lo[ i ] ), m_z_hi[ i ] );
+
+            error += std::abs( m_z[ i ] - z ) * diag;
+        }
+        return error;
+    }
+
+    const int32_t        m_max_pivots_per_row;
+
+    int32_t              m_dim;
+    std::vector<double>  m_M;
+    std::vector<double>  m_q;
+    std::vector<double>  m_z;
+    std::vector<double>  m_w;
+    std::vector<double>  m_z_lo;
+    std::vector<double>  m_z_hi;
+
+    // pivoting state
+    std::vector<State>   m_state;
+    std::vector<int32_t> m_clamped;
+    int32_t              m_num_clamped;
+    std::vector<double>  m_A;
+    std::vector<double>  m_dz;
+    std::vector<double>  m_dw;
+    std::vector<double>  m_u;
+
+    int32_t              m_iterations;
+    T                    m_error;
+    typename MLCPConvergencePolicy<T>::Status
+                         m_status;
+};
+
+#endif /*__MLCP_SOLVER_PIVOTING_HPP__*/
@@ -0,0 +1,278 @@
+#ifndef __MLCP_SOLVER_PROJECTED_JACOBI_HPP__
+#define __MLCP_SOLVER_PROJECTED_JACOBI_HPP__
+
+#include <vector>
+#include <limits>
+#include <algorithm>
+
+#include "MLCPConvergencePolicy.hpp"
+#include "SIMDFloat8.hpp"
+
+template<class T>
+class MLCPSolverProjectedJacobi {
+
+    // Solves the same problem as MLCPSolverVanillaPGS with the over-relaxed
+    // projected Jacobi iteration
+    //
+    //   z^{r+1} = clamp( z^r - omega * ( M z^r + q ) / G )
+    //
+    // where G is the diagonal of the absolute row sums of M (Gershgorin).
+    // 2G - M is diagonally dominant, so the iteration converges for any
+    // 0 < omega < 2 regardless of how many constraints share a body, whereas
+    // the plain D = diag(M) diverges for the contact-heavy rows.
+    //
+    // Unlike Gauss-Seidel all the rows read z^r, so that 8 rows are updated
+    // at once. M is stored densely in the panels of 8 rows, column by column,
+    //
+    //   panel p, column c: M[8p+0][c], M[8p+1][c], ..., M[8p+7][c]
+    //
+    // and a panel times z is a sequence of FMAs of a column of the panel and
+    // a broadcast z_c. The rows are padded to a multiple of 8 with the rows
+    // that have z fixed to 0.
+
+public:
+
+    static constexpr int32_t LANES = 8;
+
+    MLCPSolverProjectedJacobi(
+        const T       epsilon,
+        const int32_t max_num_iterations,
+        const int32_t max_stagnation
+    )
+        :m_policy      { epsilon, max_num_iterations, max_stagnation }
+        ,m_omega       { 1.6 }
+        ,m_dim         { 0 }
+        ,m_dim_padded  { 0 }
+        ,m_iterations  { 0 }
+        ,m_status      { MLCPConvergencePolicy<T>::Continue }
+    {
+        static_assert(    std::is_same< float, T >::value
+                       || std::is_same< double,T >::value );
+    }
+
+    ~MLCPSolverProjectedJacobi()
+    {
+    }
+
+    void setRelaxation( const T omega )
+    {
+        m_omega = omega;
+    }
+
+    void prepare( const int32_t dim )
+    {
+        m_dim        = dim;
+        m_dim_padded = ( ( dim + LANES - 1 ) / LANES ) * LANES;
+        m_error_history.clear();
+        m_iterations = 0;
+        m_status     = MLCPConvergencePolicy<T>::Continue;
+
+        m_panels.assign  ( m_dim_padded * m_dim, 0.0 );
+        m_q.assign       ( m_dim_padded, 0.0 );
+        m_z.assign       ( m_dim_padded, 0.0 );
+        m_z_next.assign  ( m_dim_padded, 0.0 );
+        m_z_lo.assign    ( m_dim_padded, 0.0 );
+        m_z_hi.assign    ( m_dim_padded, 0.0 );
+        m_row_sum.assign ( m_dim_padded, 1.0 );
+        m_step.assign    ( m_dim_padded, 0.0 );
+    }
+
+    void setNoLimits( const int32_t i )
+    {
+        m_z_lo[i] = -1.0 * std::numeric_limits<T>::max();
+        m_z_hi[i] = std::numeric_limits<T>::max();
+    }
+
+    void setUnilateralLimits( const int32_t i )
+    {
+        m_z_lo[i] = 0.0;
+        m_z_hi[i] = std::numeric_limits<T>::max();
+    }
+
+    void setLimits( const int32_t i, const T lo, const T hi )
+    {
+        m_z_lo[i] = lo;
+        m_z_hi[i] = hi;
+    }
+
+    void setM( const int32_t i, const int32_t j, const T v )
+    {
+        m_panels[ ( i / LANES ) * LANES * m_dim + j * LANES + ( i % LANES ) ] = v;
+    }
+
+    void setQ( const int32_t i, const T v )
+    {
+        m_q[ i ] = v;
+    }
+
+    // Initial value for warm starting. It must be within the limits.
+    void setInitialZ( const int32_t i, const T v )
+    {
+        m_z[ i ] = v;
+    }
+
+    void run()
+    {
+        calcSteps();
+
+        m_policy.start();
+        m_status = MLCPConvergencePolicy<T>::Continue;
+
+        for ( m_iterations = 0; m_status == MLCPConvergencePolicy<T>::Continue; m_iterations++ ) {
+
+            T error = 0.0;
+
+            for ( int32_t p = 0; p < m_dim_padded / LANES; p++ ) {
+
+                error += updatePanel( p );
+            }
+
+            std::swap( m_z, m_z_next );
+
+            if ( m_policy.isCheckIteration( m_iterations ) ) {
+                m_error_history.push_back( error );
+            }
+
+            m_status = m_policy.update( m_iterations, error );
+        }
+    }
+
+    const T getZ( const int32_t i ) const
+    {
+        return m_z[i];
+    }
+
+    T getError() const
+    {
+        if ( m_error_history.empty() ) {
+            return 0.0;
+        }
+        return *m_error_history.rbegin();
+    }
+
+    int32_t getIterations() const
+    {
+        return m_iterations;
+    }
+
+    typename MLCPConvergencePolicy<T>::Status getStatus() const
+    {
+        return m_status;
+    }
+
+    MLCPConvergencePolicy<T>& convergencePolicy()
+    {
+        return m_policy;
+    }
+
+private:
+
+    // step_i = omega / G_ii. The padded rows keep G_ii = 1.
+    void calcSteps()
+    {
+        for ( int32_t i = 0; i < m_dim; i++ ) {
+
+            const T* panel = &m_panels[ ( i / LANES ) * LANES * m_dim + ( i % LANES ) ];
+
+            T sum = 0.0;
+
+            for ( int32_t c = 0; c < m_dim; c++ ) {
+
+                sum += std::abs( panel[ c * LANES ] );
+            }
+            m_row_sum[ i ] = sum;
+        }
+
+        for ( int32_t i = 0; i < m_dim_padded; i++ ) {
+
+            m_step[ i ] = m_omega / m_row_sum[ i ];
+        }
+    }
+
+    // Writes the rows of the panel p of z^{r+1} into m_z_next, and returns
+    // the sum of | z^{r+1} - z^r | / step over the rows.
+    T updatePanel( const int32_t p )
+    {
+        const T* panel = &m_panels[ p * LANES * m_dim ];
+        const int32_t r = p * LANES;
+
+        if constexpr ( std::is_same< float, T >::value ) {
+
+            Float8 acc0 = Float8::zero();
+            Float8 acc1 = Float8::zero();
+
+            int32_t c = 0;
+            for ( ; c + 1 < m_dim; c += 2 ) {
+
+                acc0 = Float8::fma( Float8::load( &panel[ c * LANES ] ),       Float8::broadcast( m_z[ c ] ),     acc0 );
+                acc1 = Float8::fma( Float8::load( &panel[ ( c + 1 ) * LANES ] ), Float8::broadcast( m_z[ c + 1 ] ), acc1 );
+            }
+            if ( c < m_dim ) {
+
+                acc0 = Float8::fma( Float8::load( &panel[ c * LANES ] ), Float8::broadcast( m_z[ c ] ), acc0 );
+            }
+
+            const Float8 w      = acc0 + acc1 + Float8::load( &m_q[ r ] );
+            const Float8 z      = Float8::load( &m_z[ r ] );
+            const Float8 z_next = Float8::min(
+                Float8::max(
+                    z - w * Float8::load( &m_step[ r ] ),
+                    Float8::load( &m_z_lo[ r ] )
+                ),
+                Float8::load( &m_z_hi[ r ] )
+            );
+
+            z_next.store( &m_z_next[ r ] );
+
+            return ( ( z_next - z ).abs() * Float8::load( &m_row_sum[ r ] ) ).sum() / m_omega;
+        }
+        else {
+            T acc[ LANES ] = { 0.0 };
+
+            for ( int32_t c = 0; c < m_dim; c++ ) {
+
+                for ( int32_t l = 0; l < LANES; l++ ) {
+
+                    acc[ l ] += panel[ c * LANES + l ] * m_z[ c ];
+                }
+            }
+
+            T error = 0.0;
+
+            for ( int32_t l = 0; l < LANES; l++ ) {
+
+                const T w = acc[ l ] + m_q[ r + l ];
+
+                m_z_next[ r + l ] = std::min(
+                    std::max( m_z[ r + l ] - w * m_step[ r + l ], m_z_lo[ r + l ] ),
+                    m_z_hi[ r + l ]
+                );
+
+                error += std::abs( m_z_next[ r + l ] - m_z[ r + l ] ) * m_row_sum[ r + l ];
+            }
+
+            return error / m_omega;
+        }
+    }
+
+    MLCPConvergencePolicy<T>
+                         m_policy;
+    std::vector<T>       m_error_history;
+    T                    m_omega;
+
+    int32_t              m_dim;
+    int32_t              m_dim_padded;
+    std::vector<T>       m_panels;
+    std::vector<T>       m_q;
+    std::vector<T>       m_z;
+    std::vector<T>       m_z_next;
+    std::vector<T>       m_z_lo;
+    std::vector<T>       m_z_hi;
+    std::vector<T>       m_row_sum;
+    std::vector<T>       m_step;
+    int32_t              m_iterations;
+    typename MLCPConvergencePolicy<T>::Status
+                         m_status;
+};
+
+#endif /*__MLCP_SOLVER_PROJECTED_JACOBI_HPP__*/
@@ -2,7 +2,16 @@
 #define __MLCP_SOLVER_VANILLA_PGS_HPP__
 
 #include <vector>
+#include <new>
 #include <cstring>
+#include <cmath>
+
+#include "SparseMatrixCSR.hpp"
+#include "SparseLDLT.hpp"
+#include "MLCPConvergencePolicy.hpp"
+#include "ThreadPool.hpp"
+#include "SIMDFloat8.hpp"
+
 template<class T>
 class MLCPSolverVanillaPGS {
 
@@ -16,19 +25,118 @@ class MLCPSolverVanillaPGS {
     //
     //   The iteration formula
     //   z^{r+1} = - (q + L z^{r+1} + U z^r) / D
+    //
+    //   M is stored either densely or in CSR. In the Sparse storage
+    //   setM() must be called row by row in the increasing order of rows,
+    //   and only for the non-zero elements.
+    //
+    //   In the Dense storage, only the lower triangle of M is kept as the
+    //   TILE_SIZE x TILE_SIZE tiles (I,J), J <= I, packed row by row.
+    //   The upper triangle outside the diagonal tiles is ignored by setM(),
+    //   and rowDot() reads the row i from the tiles (I,J), J <= I, and the
+    //   column i from the tiles (J,I), J > I. calcZTiled() sweeps a tile row
+    //   at a time. z outside the tile row I does not change while its rows are
+    //   relaxed, so the dots with the tiles (I,J), J < I, and the transposed
+    //   tiles (J,I), J > I, are taken for the TILE_SIZE rows at once with the
+    //   contiguous reads, and only the diagonal tile is swept row by row.
+    //   Each element of the lower triangle is read once per sweep, at the half
+    //   of the memory of the full M. The tiles are aligned to the cache lines,
+    //   and for float the dots are taken with Float8:
+    //
+    //   (I,J), J < I: 8 accumulators, one per row r, of row r * z_J, each
+    //                 summed horizontally once per tile row.
+    //   (J,I), J > I: 1 accumulator of row c * broadcast( z_Jc ), as the row c
+    //                 of (J,I) is the column c of the transposed tile.
+    //
+    //   The error is accumulated in the same pass as before. The target is
+    //   2x over the scalar sweep of the full M with SSE2 and 5x with AVX2 for
+    //   the dims from 256 to 4096 (LinuxOpenGL/BenchmarkDensePGS.cpp).
+    //   The measured speedups were 2.4-3.5x and 5.8-6.5x, and 1.1x and 2.3x
+    //   for dim 64, where M fits in L1 anyway.
+    //
+    //   The buffers grow with a margin, and are shrunk if the problems stay
+    //   below a quarter of the allocated dimension for SHRINK_AFTER_NUM_PREPARES
+    //   consecutive prepare() calls.
+    //
+    //   The termination is decided by MLCPConvergencePolicy with the error
+    //   accumulated in calcZ() from the row dots it calculates anyway.
+    //
+    //   With setColoring(), the rows are relaxed color by color, and the rows
+    //   of a color are relaxed in parallel on the thread pool. No two rows of
+    //   a color share a non-zero column, so the result is still Gauss-Seidel,
+    //   only with the rows in a different order.
+    //
+    //   With setDirectRows(n), the first n rows, which must have no limits,
+    //   are solved as a block in each iteration (block Gauss-Seidel):
+    //
+    //   M_BB z_B^{r+1} = - ( q_B + M_BU z_U^r )
+    //
+    //   with the sparse LDL^T factorization of M_BB computed once in run(),
+    //   and the remaining rows are relaxed as usual. For the bilateral
+    //   constraints of a chain, M_BB is tridiagonal and the solve is O(n),
+    //   and the chain stays rigid regardless of the number of iterations.
+    //
+    //   With setNNCG(true), the sweeps are accelerated with the nonsmooth
+    //   nonlinear conjugate gradient [Silcowitz et al. 2010]. The sweep is
+    //   taken as a gradient step, r^k = z^k - PGS( z^k ), and
+    //
+    //   beta    = |r^k|^2 / |r^{k-1}|^2  (Fletcher-Reeves)
+    //   z^{k+1} = clamp( PGS( z^k ) + beta p^{k-1} )
+    //   p^k     = beta p^{k-1} - r^k
+    //
+    //   p is reset to 0 when beta > 1, i.e., the sweeps stopped making progress.
+    //
+    //   The rows are over-relaxed with omega (SOR)
+    //
+    //   z_i^{r+1} = clamp( z_i^r - omega ( q_i + L z^{r+1} + U z^r + D z^r )_i / D_ii )
+    //
+    //   With setAdaptiveRelaxation(true), the sweeps start with omega = 1, and
+    //   omega is tuned from m_error_history in the check iterations, raised
+    //   while the error keeps decreasing and halved towards 1 when it goes up.
+    //   See adaptRelaxation(). It costs nothing per sweep.
 
 public:
 
+    static constexpr int32_t COLOR_CHUNK_SIZE = 128;
+
+    static constexpr int32_t TILE_SIZE = 8;
+
+    static constexpr size_t  TILE_ALIGNMENT = 64;
+
+    static constexpr int32_t SHRINK_AFTER_NUM_PREPARES = 120;
+
+    static constexpr int32_t RELAXATION_PERIOD = 8;
+    static constexpr T       RELAXATION_STEP   = 0.2;
+
+    typedef enum _StorageType {
+        Dense,
+        Sparse
+    } StorageType;
+
     MLCPSolverVanillaPGS(
         const T       epsilon,
         const int32_t max_num_iterations,
         const int32_t max_stagnation
     )
-        :m_epsilon            { epsilon }
-        ,m_base               { nullptr }
-        ,m_allocated_dim      { 0 }
-        ,m_max_num_iterations { max_num_iterations }
-        ,m_max_stagnation     { max_stagnation }
+        :m_policy              { epsilon, max_num_iterations, max_stagnation }
+        ,m_base                { nullptr }
+        ,m_allocated_dim       { 0 }
+        ,m_M                   { nullptr }
+        ,m_allocated_dim_M     { 0 }
+        ,m_num_small_prepares  { 0 }
+        ,m_num_small_prepares_M{ 0 }
+        ,m_storage             { Dense }
+        ,m_thread_pool         { nullptr }
+        ,m_dim_direct          { 0 }
+        ,m_omega               { 1.0 }
+        ,m_omega_fixed         { 1.0 }
+        ,m_omega_max           { 1.9 }
+        ,m_adaptive_relaxation { false }
+        ,m_nncg                { false }
+        ,m_r_sq_prev           { 0.0 }
+        ,m_num_nncg_restarts   { 0 }
+        ,m_iterations          { 0 }
+        ,m_status              { MLCPConvergencePolicy<T>::Continue }
     {
         static_assert(    std::is_same< float, T >::value
                        || std::is_same< double,T >::value );
@@ -39,16 +147,33 @@ public:
         releaseMemory();
     }
 
-    void prepare( const int32_t dim )
+    void prepare( const int32_t dim, const StorageType storage = Dense )
     {
-        m_dim = dim;
+        m_dim     = dim;
+        m_storage = storage;
         allocateMemory( dim );
         m_error_history.clear();
         m_iterations = 0;
+        m_status     = MLCPConvergencePolicy<T>::Continue;
+        m_thread_pool = nullptr;
+        m_dim_direct  = 0;
+
+        if ( m_storage == Dense ) {
+
+            memset( m_M, 0, sizeof(T) * packedSize( m_dim ) );
+        }
+        else {
+            m_M_sparse.reset( dim );
+        }
 
-        memset( m_M, 0, sizeof(T) * m_dim * m_dim );
         memset( m_q, 0, sizeof(T) * m_dim );
-        memset( m_z, 0, sizeof(T) * this->m_dim );
+
+        // z is padded to the tiles, as the padding is multiplied by the zeros of M.
+        memset( m_z, 0, sizeof(T) * numTiles( m_dim ) * TILE_SIZE );
+
+        // the conjugate direction of NNCG starts from zero.
+        memset( m_p, 0, sizeof(T) * m_dim );
+        m_r_sq_prev = 0.0;
     }
 
     void setNoLimits( const int32_t i )
@@ -63,33 +188,132 @@ public:
         m_z_hi[i] = std::numeric_limits<T>::max();
     }
 
-    void setLimits( const int32_t i, const float lo, const float hi )
+    void setLimits( const int32_t i, const T lo, const T hi )
     {
         m_z_lo[i] = lo;
         m_z_hi[i] = hi;
     }
 
-    void setM( const int32_t i, const int32_t j, const float v )
+    // Fixed over-relaxation factor. 0 < omega < 2.
+    void setRelaxation( const T omega )
     {
-        m_M[ i * m_dim + j ] = v;
+        m_omega_fixed = omega;
     }
 
-    void setQ( const int32_t i, const float v )
+    void setAdaptiveRelaxation( const bool adaptive, const T omega_max = 1.9 )
+    {
+        m_adaptive_relaxation = adaptive;
+        m_omega_max           = omega_max;
+    }
+
+    // The omega used at the end of the last run.
+    T getRelaxation() const
+    {
+        return m_omega;
+    }
+
+    void setNNCG( const bool nncg )
+    {
+        m_nncg = nncg;
+    }
+
+    // Solves the first dim_direct rows directly. They must have no limits.
+    // It must be called after prepare() and before setM().
+    void setDirectRows( const int32_t dim_direct )
+    {
+        m_dim_direct = dim_direct;
+        m_ldlt.reset( dim_direct );
+    }
+
+    void setM( const int32_t i, const int32_t j, const T v )
+    {
+        if ( m_storage == Dense ) {
+
+            if ( j / TILE_SIZE <= i / TILE_SIZE ) {
+
+                element( i, j ) = v;
+            }
+        }
+        else {
+            m_M_sparse.append( i, j, v );
+        }
+
+        if ( i < m_dim_direct && j < m_dim_direct ) {
+
+            m_ldlt.append( i, j, v );
+        }
+    }
+
+    void setQ( const int32_t i, const T v )
     {
         m_q[ i ] = v;
     }
 
+    // Initial value for warm starting. It must be within the limits.
+    void setInitialZ( const int32_t i, const T v )
+    {
+        m_z[ i ] = v;
+    }
+
+    // Enables the colored multithreaded sweep. Only for the Sparse storage.
+    // rows_by_color[ color_begin[c] ... color_begin[c+1]-1 ] are the rows of the color c.
+    // The direct rows must not be included.
+    // It must be called after prepare().
+    void setColoring(
+        const std::vector<int32_t>& rows_by_color,
+        const std::vector<int32_t>& color_begin,
+        ThreadPool*                 thread_pool
+    ) {
+        m_color_rows.assign ( rows_by_color.begin(), rows_by_color.end() );
+        m_color_begin.assign( color_begin.begin(),   color_begin.end()   );
+        m_thread_pool = thread_pool;
+    }
+
     void run()
     {
-        for ( m_iterations = 0; m_iterations < m_max_num_iterations; m_iterations++ ) {
-        
-            calcZ();
+        if ( m_storage == Sparse ) {
+
+            m_M_sparse.finish();
+        }
+
+        if ( m_dim_direct > 0 ) {
+
+            m_ldlt.factorize();
+        }
+
+        m_num_nncg_restarts = 0;
+        m_omega = m_adaptive_relaxation ? 1.0 : m_omega_fixed;
+
+        m_policy.start();
+        m_status = MLCPConvergencePolicy<T>::Continue;
+
+        for ( m_iterations = 0; m_status == MLCPConvergencePolicy<T>::Continue; m_iterations++ ) {
+
+            const bool check = m_policy.isCheckIteration( m_iterations );
 
-            calcMeritError();
+            if ( m_nncg ) {
 
-            if ( checkForErrorStagnation() ) {
-                break;
+                memcpy( m_z_prev, m_z, sizeof(T) * m_dim );
             }
+
+            T error = ( m_dim_direct > 0 ) ? calcZDirect() : 0.0;
+
+            error += ( m_thread_pool != nullptr ) ? calcZColored( check ) : calcZ( check );
+
+            if ( m_nncg ) {
+
+                applyConjugateDirection( m_iterations == 0 );
+            }
+
+            if ( check ) {
+                m_error_history.push_back( error );
+
+                if ( m_adaptive_relaxation ) {
+                    adaptRelaxation();
+                }
+            }
+
+            m_status = m_policy.update( m_iterations, error );
         }
     }
 
@@ -106,27 +330,121 @@ public:
         return *m_error_history.rbegin();
     }
 
+    int32_t getIterations() const
+    {
+        return m_iterations;
+    }
+
+    typename MLCPConvergencePolicy<T>::Status getStatus() const
+    {
+        return m_status;
+    }
+
+    MLCPConvergencePolicy<T>& convergencePolicy()
+    {
+        return m_policy;
+    }
+
+    int32_t getNumNNCGRestarts() const
+    {
+        return m_num_nncg_restarts;
+    }
+
 private:
 
+    // Returns true if the buffer for allocated_dim must be reallocated for
+    // requested_dim, i.e., it is too small or has been too large for a while.
+    bool needsReallocation( const int32_t requested_dim, const int32_t allocated_dim, int32_t& num_small_prepares )
+    {
+        if ( allocated_dim < requested_dim ) {
+
+            num_small_prepares = 0;
+            return true;
+        }
+
+        if ( requested_dim * 4 < allocated_dim ) {
+
+            num_small_prepares++;
+        }
+        else {
+            num_small_prepares = 0;
+        }
+
+        if ( num_small_prepares >= SHRINK_AFTER_NUM_PREPARES ) {
+
+            num_small_prepares = 0;
+            return true;
+        }
+        return false;
+    }
+
     void allocateMemory( const int32_t requested_dim )
     {
-        if ( m_allocated_dim < requested_dim ) {
+        if ( needsReallocation( requested_dim, m_allocated_dim, m_num_small_prepares ) ) {
 
-            releaseMemory();
+            if ( m_base != nullptr ) {
 
-            const int32_t dim = requested_dim * 2;
+                delete[] m_base;
+                m_base = nullptr;
+            }
+
+            const int32_t dim = numTiles( requested_dim * 2 ) * TILE_SIZE;
 
-            m_base = new T[ ( dim + 5 ) * dim ];
+            m_base = new T[ 7 * dim ];
 
-            m_M    = m_base;
-            m_q    = &(m_base[ ( dim     ) * dim ]);
-            m_z    = &(m_base[ ( dim + 1 ) * dim ]);
-            m_w    = &(m_base[ ( dim + 2 ) * dim ]);
-            m_z_lo = &(m_base[ ( dim + 3 ) * dim ]);
-            m_z_hi = &(m_base[ ( dim + 4 ) * dim ]);
+            m_q      = &(m_base[ 0 ]);
+            m_z      = &(m_base[ dim ]);
+            m_w      = &(m_base[ 2 * dim ]);
+            m_z_lo   = &(m_base[ 3 * dim ]);
+            m_z_hi   = &(m_base[ 4 * dim ]);
+            m_z_prev = &(m_base[ 5 * dim ]);
+            m_p      = &(m_base[ 6 * dim ]);
 
             m_allocated_dim = dim;
         }
+
+        // The dense M is allocated only when the dense storage is used.
+        // It is quadratic in dim, so it grows with a smaller margin.
+        if (    m_storage == Dense
+             && needsReallocation( requested_dim, m_allocated_dim_M, m_num_small_prepares_M )
+        ) {
+            if ( m_M != nullptr ) {
+                ::operator delete[]( m_M, std::align_val_t{ TILE_ALIGNMENT } );
+            }
+
+            const int32_t dim = numTiles( requested_dim + requested_dim / 4 ) * TILE_SIZE;
+
+            m_M = static_cast<T*>(
+                ::operator new[]( sizeof(T) * packedSize( dim ), std::align_val_t{ TILE_ALIGNMENT } )
+            );
+
+            m_allocated_dim_M = dim;
+        }
+    }
+
+    static int32_t numTiles( const int32_t dim )
+    {
+        return ( dim + TILE_SIZE - 1 ) / TILE_SIZE;
+    }
+
+    // The number of the elements in the packed tiles of the lower triangle.
+    static size_t packedSize( const int32_t dim )
+    {
+        const size_t n = numTiles( dim );
+
+        return n * ( n + 1 ) / 2 * TILE_SIZE * TILE_SIZE;
+    }
+
+    // The tile (I,J), J <= I.
+    T* tile( const int32_t I, const int32_t J ) const
+    {
+        return &( m_M[ ( (size_t)I * ( I + 1 ) / 2 + J ) * TILE_SIZE * TILE_SIZE ] );
+    }
+
+    // M_ij in the tile ( i / TILE_SIZE, j / TILE_SIZE ), j / TILE_SIZE <= i / TILE_SIZE.
+    T& element( const int32_t i, const int32_t j ) const
+    {
+        return tile( i / TILE_SIZE, j / TILE_SIZE )[ ( i % TILE_SIZE ) * TILE_SIZE + j % TILE_SIZE ];
     }
 
     void releaseMemory()
@@ -135,91 +453,394 @@ private:
 
             delete[] m_base;
             m_base = nullptr;
+            m_allocated_dim = 0;
+        }
+
+        if ( m_M != nullptr ) {
+
+            ::operator delete[]( m_M, std::align_val_t{ TILE_ALIGNMENT } );
+            m_M = nullptr;
+            m_allocated_dim_M = 0;
         }
     }
 
-    void calcZ()
+    T diagonal( const int32_t row ) const
     {
-        // calc z^{r+1} = - (q + L z^{r+1} + U z^r) / D
+        if ( m_storage == Dense ) {
 
-        for ( int32_t row = 0; row < m_dim; row++ ) {
+            return element( row, row );
+        }
+        return m_M_sparse.diagonal( row );
+    }
 
-            T diag = this->m_M[ row * this->m_dim + row ];
+    T rowDot( const int32_t row ) const
+    {
+        if ( m_storage == Sparse ) {
 
-            T dot = 0.0;
+            return m_M_sparse.rowDot( row, m_z );
+        }
+
+        const int32_t I         = row / TILE_SIZE;
+        const int32_t r         = row % TILE_SIZE;
+        const int32_t num_tiles = numTiles( m_dim );
+
+        T dot = 0.0;
+
+        // the row r of the tiles (I,J), J <= I.
+        for ( int32_t J = 0; J <= I; J++ ) {
 
-            for ( int32_t col = 0; col < m_dim; col++ ) {
+            const T* m = tile( I, J ) + r * TILE_SIZE;
+            const T* z = &( m_z[ J * TILE_SIZE ] );
 
-                dot += m_M[ row * m_dim + col ] * m_z[ col ];
+            for ( int32_t c = 0; c < TILE_SIZE; c++ ) {
+
+                dot += m[ c ] * z[ c ];
             }
+        }
 
-            m_z[row] = clamp(
-                ( diag * m_z[ row ] - dot - m_q[ row ] ) / diag,
-                m_z_lo[ row ],
-                m_z_hi[ row ]
-            );
+        // the column r of the tiles (J,I), J > I.
+        for ( int32_t J = I + 1; J < num_tiles; J++ ) {
+
+            const T* m = tile( J, I ) + r;
+            const T* z = &( m_z[ J * TILE_SIZE ] );
+
+            for ( int32_t c = 0; c < TILE_SIZE; c++ ) {
+
+                dot += m[ c * TILE_SIZE ] * z[ c ];
+            }
+        }
+        return dot;
+    }
+
+    // Returns the error if requested. The error is the sum of the natural residuals
+    //
+    //   | z_i - clamp( z_i - w_i / M_ii ) | * M_ii,
+    //
+    // which is |w_i| for the rows within the limits, at the time each row is updated.
+    T calcZ( const bool calc_error )
+    {
+        if ( m_storage == Dense ) {
+
+            return calcZTiled( calc_error );
+        }
+
+        T error = 0.0;
+
+        for ( int32_t row = m_dim_direct; row < m_dim; row++ ) {
+
+            const T row_error = relaxRow( row );
+
+            if ( calc_error ) {
+                error += row_error;
+            }
         }
+
+        return error;
     }
 
-    void calcMeritError()
+    T calcZTiled( const bool calc_error )
     {
         T error = 0.0;
 
-        for ( int32_t row = 0; row < m_dim; row++ ) {
+        const int32_t num_tiles = numTiles( m_dim );
+
+        for ( int32_t I = m_dim_direct / TILE_SIZE; I < num_tiles; I++ ) {
+
+            T dots[ TILE_SIZE ];
+
+            calcOffDiagonalDots( I, dots );
+
+            const T*      d         = tile( I, I );
+            const T*      z         = &( m_z[ I * TILE_SIZE ] );
+            const int32_t row_begin = std::max( I * TILE_SIZE, m_dim_direct );
+            const int32_t row_end   = std::min( ( I + 1 ) * TILE_SIZE, m_dim );
 
-            if (    ( m_z[row] > m_z_lo[row] + m_epsilon )
-                 && ( m_z[row] < m_z_hi[row] - m_epsilon )
-            ) {
-                T dot = 0.0;
+            for ( int32_t row = row_begin; row < row_end; row++ ) {
 
-                for ( int32_t col = 0; col < m_dim; col++ ) {
+                const T* m   = d + ( row % TILE_SIZE ) * TILE_SIZE;
+                T        dot = dots[ row % TILE_SIZE ];
 
-                    dot += m_M[ row * m_dim + col ] * m_z[ col ];
+                for ( int32_t c = 0; c < TILE_SIZE; c++ ) {
+
+                    dot += m[ c ] * z[ c ];
                 }
-                const T mzq = dot + m_q[row];
 
-                error += std::abs( mzq );
+                const T row_error = relaxRow( row, dot );
+
+                if ( calc_error ) {
+                    error += row_error;
+                }
             }
         }
 
-        m_error_history.push_back( error );
+        return error;
     }
 
-    bool checkForErrorStagnation()
+    // dots[r] = sum_{J<I} tile(I,J) row r . z_J + sum_{J>I} tile(J,I) column r . z_J
+    void calcOffDiagonalDots( const int32_t I, T* dots ) const
     {
-        int32_t count{ 0 };
+        const int32_t num_tiles = numTiles( m_dim );
+
+        if constexpr ( std::is_same< float, T >::value && TILE_SIZE == 8 ) {
 
-        for ( int i = 1; i < m_error_history.size(); i++ ) {
+            Float8 acc_rows[ TILE_SIZE ];
 
-            if ( m_error_history[ i - 1 ] <  m_error_history[ i ] ) {
-                count++;
+            for ( int32_t r = 0; r < TILE_SIZE; r++ ) {
+                acc_rows[ r ] = Float8::zero();
             }
+
+            for ( int32_t J = 0; J < I; J++ ) {
+
+                const T*     m = tile( I, J );
+                const Float8 z = Float8::load( &m_z[ J * TILE_SIZE ] );
+
+                for ( int32_t r = 0; r < TILE_SIZE; r++ ) {
+
+                    acc_rows[ r ] = Float8::fma( Float8::load( &m[ r * TILE_SIZE ] ), z, acc_rows[ r ] );
+                }
+            }
+
+            Float8 acc0 = Float8::zero();
+            Float8 acc1 = Float8::zero();
+
+            for ( int32_t J = I + 1; J < num_tiles; J++ ) {
+
+                const T* m = tile( J, I );
+                const T* z = &( m_z[ J * TILE_SIZE ] );
+
+                for ( int32_t c = 0; c < TILE_SIZE; c += 2 ) {
+
+                    acc0 = Float8::fma( Float8::load( &m[ c * TILE_SIZE ] ),       Float8::broadcast( z[ c ] ),     acc0 );
+                    acc1 = Float8::fma( Float8::load( &m[ ( c + 1 ) * TILE_SIZE ] ), Float8::broadcast( z[ c + 1 ] ), acc1 );
+                }
+            }
+
+            ( acc0 + acc1 ).store( dots );
+
+            for ( int32_t r = 0; r < TILE_SIZE; r++ ) {
+
+                dots[ r ] += acc_rows[ r ].sum();
+            }
+            return;
         }
 
-        return count > m_max_stagnation;
+        for ( int32_t r = 0; r < TILE_SIZE; r++ ) {
+
+            T dot = 0.0;
+
+            for ( int32_t J = 0; J < I; J++ ) {
+
+                const T* m = tile( I, J ) + r * TILE_SIZE;
+                const T* z = &( m_z[ J * TILE_SIZE ] );
+
+                for ( int32_t c = 0; c < TILE_SIZE; c++ ) {
+
+                    dot += m[ c ] * z[ c ];
+                }
+            }
+            dots[ r ] = dot;
+        }
+
+        for ( int32_t J = I + 1; J < num_tiles; J++ ) {
+
+            const T* m = tile( J, I );
+            const T* z = &( m_z[ J * TILE_SIZE ] );
+
+            for ( int32_t c = 0; c < TILE_SIZE; c++ ) {
+
+                for ( int32_t r = 0; r < TILE_SIZE; r++ ) {
+
+                    dots[ r ] += m[ c * TILE_SIZE + r ] * z[ c ];
+                }
+            }
+        }
     }
 
-    T clamp( const T val, const T lo, const T hi )
+    // Every RELAXATION_PERIOD checks, omega is increased by RELAXATION_STEP if
+    // the error has decreased over the period, and halved towards 1 otherwise.
+    // The error is compared over a period, as it rises briefly after each
+    // change of omega even if it decreases faster in the end.
+    void adaptRelaxation()
     {
-        return std::min ( std::max ( val, lo ), hi );
+        const auto n = (int32_t)m_error_history.size();
+
+        if ( n <= RELAXATION_PERIOD || n % RELAXATION_PERIOD != 0 ) {
+            return;
+        }
+
+        if ( m_error_history[ n - 1 ] < m_error_history[ n - 1 - RELAXATION_PERIOD ] ) {
+
+            m_omega = std::min( m_omega_max, m_omega + RELAXATION_STEP );
+        }
+        else {
+            m_omega = 1.0 + 0.5 * ( m_omega - 1.0 );
+        }
+    }
+
+    // m_z holds PGS( z^k ) and m_z_prev holds z^k.
+    void applyConjugateDirection( const bool first )
+    {
+        T r_sq = 0.0;
+
+        for ( int32_t i = 0; i < m_dim; i++ ) {
+
+            const T r = m_z_prev[ i ] - m_z[ i ];
+            r_sq += r * r;
+        }
+
+        const T beta = ( first || m_r_sq_prev == 0.0 ) ? 0.0 : r_sq / m_r_sq_prev;
+
+        m_r_sq_prev = r_sq;
+
+        if ( beta > 1.0 ) {
+
+            memset( m_p, 0, sizeof(T) * m_dim );
+            m_num_nncg_restarts++;
+            return;
+        }
+
+        for ( int32_t i = 0; i < m_dim; i++ ) {
+
+            const T r = m_z_prev[ i ] - m_z[ i ];
+
+            m_z[ i ] = clamp( m_z[ i ] + beta * m_p[ i ], m_z_lo[ i ], m_z_hi[ i ] );
+            m_p[ i ] = beta * m_p[ i ] - r;
+        }
     }
 
-    const T        m_epsilon;
-    const int32_t  m_max_num_iterations;
-    const int32_t  m_max_stagnation;
-    std::vector<T> m_error_history;
+    // Solves the direct rows as a block and returns the sum of |w_i| before the solve.
+    T calcZDirect()
+    {
+        T error = 0.0;
+
+        for ( int32_t row = 0; row < m_dim_direct; row++ ) {
+
+            m_w[ row ] = -1.0 * ( rowDot( row ) + m_q[ row ] );
+
+            error += std::abs( m_w[ row ] );
+        }
 
-    T*             m_base;
-    int32_t        m_allocated_dim;
+        m_ldlt.solve( m_w );
+
+        for ( int32_t row = 0; row < m_dim_direct; row++ ) {
+
+            m_z[ row ] += m_w[ row ];
+        }
+
+        return error;
+    }
+
+    T calcZColored( const bool calc_error )
+    {
+        T error = 0.0;
+
+        const auto num_colors = (int32_t)m_color_begin.size() - 1;
+
+        for ( int32_t c = 0; c < num_colors; c++ ) {
+
+            const auto begin      = m_color_begin[ c ];
+            const auto end        = m_color_begin[ c + 1 ];
+            const auto num_chunks = ( end - begin + COLOR_CHUNK_SIZE - 1 ) / COLOR_CHUNK_SIZE;
+
+            m_chunk_errors.assign( num_chunks, 0.0 );
+
+            m_thread_pool->run( num_chunks, [this, begin, end]( const int32_t k ) {
+
+                const auto chunk_begin = begin + k * COLOR_CHUNK_SIZE;
+                const auto chunk_end   = std::min( end, chunk_begin + COLOR_CHUNK_SIZE );
+
+                T chunk_error = 0.0;
+
+                for ( int32_t i = chunk_begin; i < chunk_end; i++ ) {
+
+                    chunk_error += relaxRow( m_color_rows[ i ] );
+                }
+
+                m_chunk_errors[ k ] = chunk_error;
+            } );
+
+            if ( calc_error ) {
+
+                for ( const auto e : m_chunk_errors ) {
+                    error += e;
+                }
+            }
+        }
+
+        return error;
+    }
+
+    // Updates z_row and returns its error.
+    T relaxRow( const int32_t row )
+    {
+        return relaxRow( row, rowDot( row ) );
+    }
+
+    // dot is M_row . z
+    T relaxRow( const int32_t row, const T dot )
+    {
+        // calc z^{r+1} = z^r - omega (q + L z^{r+1} + U z^r + D z^r) / D
+
+        const T diag = diagonal( row );
+
+        const T z_prev = m_z[ row ];
+
+        m_z[row] = clamp(
+            z_prev - m_omega * ( dot + m_q[ row ] ) / diag,
+            m_z_lo[ row ],
+            m_z_hi[ row ]
+        );
+
+        return std::abs( m_z[ row ] - z_prev ) * diag / m_omega;
+    }
+
+    T clamp( const T val, const T lo, const T hi )
+    {
+        return std::min ( std::max ( val, lo ), hi );
+    }
 
-    int32_t        m_dim;
-    T*             m_M;
-    T*             m_q;
-    T*             m_z;
-    T*             m_w;
-    T*             m_z_lo;
-    T*             m_z_hi;
-    int32_t        m_iterations;
+    MLCPConvergencePolicy<T>
+                         m_policy;
+    std::vector<T>       m_error_history;
+
+    T*                   m_base;
+    int32_t              m_allocated_dim;
+
+    T*                   m_M;
+    int32_t              m_allocated_dim_M;
+    int32_t              m_num_small_prepares;
+    int32_t              m_num_small_prepares_M;
+    SparseMatrixCSR<T>   m_M_sparse;
+    StorageType          m_storage;
+
+    std::vector<int32_t> m_color_rows;
+    std::vector<int32_t> m_color_begin;
+    std::vector<T>       m_chunk_errors;
+    ThreadPool*          m_thread_pool;
+
+    int32_t              m_dim_direct;
+    SparseLDLT<T>        m_ldlt;
+
+    T                    m_omega;
+    T                    m_omega_fixed;
+    T                    m_omega_max;
+    bool                 m_adaptive_relaxation;
+
+    bool                 m_nncg;
+    T                    m_r_sq_prev;
+    int32_t              m_num_nncg_restarts;
+
+    int32_t              m_dim;
+    T*                   m_q;
+    T*                   m_z;
+    T*                   m_w;
+    T*                   m_z_lo;
+    T*                   m_z_hi;
+    T*                   m_z_prev;
+    T*                   m_p;
+    int32_t              m_iterations;
+    typename MLCPConvergencePolicy<T>::Status
+                         m_status;
 };
 
 #endif /*__MLCP_SOLVER_VANILLA_PGS_HPP__*/
@@ -0,0 +1,236 @@
+#ifndef __SIMD_FLOAT8_HPP__
+#define __SIMD_FLOAT8_HPP__
+
+#if defined(__AVX2__) && defined(__FMA__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
+#include <algorithm>
+
+// 8 floats processed at once.
+// AVX2+FMA if available, otherwise two SSE or AArch64 NEON registers, otherwise scalar.
+// NEON is AArch64 only, as the reductions and vfmaq_f32 are not in ARMv7.
+// The loads and the stores do not require alignment.
+
+struct Float8 {
+
+#if defined(__AVX2__) && defined(__FMA__)
+
+    __m256 v;
+
+    static Float8 zero()                       { return Float8{ _mm256_setzero_ps() }; }
+    static Float8 broadcast( const float a )   { return Float8{ _mm256_set1_ps( a ) }; }
+    static Float8 load( const float* p )       { return Float8{ _mm256_loadu_ps( p ) }; }
+    void store( float* p ) const               { _mm256_storeu_ps( p, v ); }
+
+    // a * b + c
+    static Float8 fma( const Float8& a, const Float8& b, const Float8& c )
+    {
+        return Float8{ _mm256_fmadd_ps( a.v, b.v, c.v ) };
+    }
+
+    Float8 operator+( const Float8& rhs ) const { return Float8{ _mm256_add_ps( v, rhs.v ) }; }
+    Float8 operator-( const Float8& rhs ) const { return Float8{ _mm256_sub_ps( v, rhs.v ) }; }
+    Float8 operator*( const Float8& rhs ) const { return Float8{ _mm256_mul_ps( v, rhs.v ) }; }
+
+    static Float8 min( const Float8& a, const Float8& b ) { return Float8{ _mm256_min_ps( a.v, b.v ) }; }
+    static Float8 max( const Float8& a, const Float8& b ) { return Float8{ _mm256_max_ps( a.v, b.v ) }; }
+
+    Float8 abs() const
+    {
+        return Float8{ _mm256_andnot_ps( _mm256_set1_ps( -0.0f ), v ) };
+    }
+
+    // true if all the 8 are 0.0 or -0.0.
+    bool isZero() const
+    {
+        return _mm256_movemask_ps( _mm256_cmp_ps( v, _mm256_setzero_ps(), _CMP_NEQ_UQ ) ) == 0;
+    }
+
+    float sum() const
+    {
+        const __m128 h = _mm_add_ps( _mm256_castps256_ps128( v ), _mm256_extractf128_ps( v, 1 ) );
+        const __m128 s = _mm_add_ps( h, _mm_movehl_ps( h, h ) );
+        return _mm_cvtss_f32( _mm_add_ss( s, _mm_shuffle_ps( s, s, 1 ) ) );
+    }
+
+#elif defined(__SSE2__)
+
+    __m128 lo;
+    __m128 hi;
+
+    static Float8 zero()                       { return Float8{ _mm_setzero_ps(), _mm_setzero_ps() }; }
+    static Float8 broadcast( const float a )   { return Float8{ _mm_set1_ps( a ), _mm_set1_ps( a ) }; }
+    static Float8 load( const float* p )       { return Float8{ _mm_loadu_ps( p ), _mm_loadu_ps( p + 4 ) }; }
+    void store( float* p ) const               { _mm_storeu_ps( p, lo ); _mm_storeu_ps( p + 4, hi ); }
+
+    static Float8 fma( const Float8& a, const Float8& b, const Float8& c )
+    {
+        return Float8{ _mm_add_ps( _mm_mul_ps( a.lo, b.lo ), c.lo ), _mm_add_ps( _mm_mul_ps( a.hi, b.hi ), c.hi ) };
+    }
+
+    Float8 operator+( const Float8& rhs ) const { return Float8{ _mm_add_ps( lo, rhs.lo ), _mm_add_ps( hi, rhs.hi ) }; }
+    Float8 operator-( const Float8& rhs ) const { return Float8{ _mm_sub_ps( lo, rhs.lo ), _mm_sub_ps( hi, rhs.hi ) }; }
+    Float8 operator*( const Float8& rhs ) const { return Float8{ _mm_mul_ps( lo, rhs.lo ), _mm_mul_ps( hi, rhs.hi ) }; }
+
+    static Float8 min( const Float8& a, const Float8& b ) { return Float8{ _mm_min_ps( a.lo, b.lo ), _mm_min_ps( a.hi, b.hi ) }; }
+    static Float8 max( const Float8& a, const Float8& b ) { return Float8{ _mm_max_ps( a.lo, b.lo ), _mm_max_ps( a.hi, b.hi ) }; }
+
+    Float8 abs() const
+    {
+        const __m128 sign = _mm_set1_ps( -0.0f );
+        return Float8{ _mm_andnot_ps( sign, lo ), _mm_andnot_ps( sign, hi ) };
+    }
+
+    bool isZero() const
+    {
+        const __m128 zero = _mm_setzero_ps();
+        return _mm_movemask_ps( _mm_or_ps( _mm_cmpneq_ps( lo, zero ), _mm_cmpneq_ps( hi, zero ) ) ) == 0;
+    }
+
+    float sum() const
+    {
+        const __m128 h = _mm_add_ps( lo, hi );
+        const __m128 s = _mm_add_ps( h, _mm_movehl_ps( h, h ) );
+        return _mm_cvtss_f32( _mm_add_ss( s, _mm_shuffle_ps( s, s, 1 ) ) );
+    }
+
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+
+    float32x4_t lo;
+    float32x4_t hi;
+
+    static Float8 zero()                       { return Float8{ vdupq_n_f32( 0.0f ), vdupq_n_f32( 0.0f ) }; }
+    static Float8 broadcast( const float a )   { return Float8{ vdupq_n_f32( a ), vdupq_n_f32( a ) }; }
+    static Float8 load( const float* p )       { return Float8{ vld1q_f32( p ), vld1q_f32( p + 4 ) }; }
+    void store( float* p ) const               { vst1q_f32( p, lo ); vst1q_f32( p + 4, hi ); }
+
+    static Float8 fma( const Float8& a, const Float8& b, const Float8& c )
+    {
+        return Float8{ vfmaq_f32( c.lo, a.lo, b.lo ), vfmaq_f32( c.hi, a.hi, b.hi ) };
+    }
+
+    Float8 operator+( const Float8& rhs ) const { return Float8{ vaddq_f32( lo, rhs.lo ), vaddq_f32( hi, rhs.hi ) }; }
+    Float8 operator-( const Float8& rhs ) const { return Float8{ vsubq_f32( lo, rhs.lo ), vsubq_f32( hi, rhs.hi ) }; }
+    Float8 operator*( const Float8& rhs ) const { return Float8{ vmulq_f32( lo, rhs.lo ), vmulq_f32( hi, rhs.hi ) }; }
+
+    static Float8 min( const Float8& a, const Float8& b ) { return Float8{ vminq_f32( a.lo, b.lo ), vminq_f32( a.hi, b.hi ) }; }
+    static Float8 max( const Float8& a, const Float8& b ) { return Float8{ vmaxq_f32( a.lo, b.lo ), vmaxq_f32( a.hi, b.hi ) }; }
+
+    Float8 abs() const
+    {
+        return Float8{ vabsq_f32( lo ), vabsq_f32( hi ) };
+    }
+
+    bool isZero() const
+    {
+        return vmaxvq_f32( vmaxq_f32( vabsq_f32( lo ), vabsq_f32( hi ) ) ) == 0.0f;
+    }
+
+    float sum() const
+    {
+        return vaddvq_f32( vaddq_f32( lo, hi ) );
+    }
+
+#else
+
+    float v[8];
+
+    static Float8 zero()
+    {
+        return broadcast( 0.0f );
+    }
+
+    static Float8 broadcast( const float a )
+    {
+        Float8 r;
+        for ( int i = 0; i < 8; i++ ) { r.v[i] = a; }
+        return r;
+    }
+
+    static Float8 load( const float* p )
+    {
+        Float8 r;
+        for ( int i = 0; i < 8; i++ ) { r.v[i] = p[i]; }
+        return r;
+    }
+
+    void store( float* p ) const
+    {
+        for ( int i = 0; i < 8; i++ ) { p[i] = v[i]; }
+    }
+
+    static Float8 fma( const Float8& a, const Float8& b, const Float8& c )
+    {
+        Float8 r;
+        for ( int i = 0; i < 8; i++ ) { r.v[i] = a.v[i] * b.v[i] + c.v[i]; }
+        return r;
+    }
+
+    Float8 operator+( const Float8& rhs ) const
+    {
+        Float8 r;
+        for ( int i = 0; i < 8; i++ ) { r.v[i] = v[i] + rhs.v[i]; }
+        return r;
+    }
+
+    Float8 operator-( const Float8& rhs ) const
+    {
+        Float8 r;
+        for ( int i = 0; i < 8; i++ ) { r.v[i] = v[i] - rhs.v[i]; }
+        return r;
+    }
+
+    Float8 operator*( const Float8& rhs ) const
+    {
+        Float8 r;
+        for ( int i = 0; i < 8; i++ ) { r.v[i] = v[i] * rhs.v[i]; }
+        return r;
+    }
+
+    static Float8 min( const Float8& a, const Float8& b )
+    {
+        Float8 r;
+        for ( int i = 0; i < 8; i++ ) { r.v[i] = std::min( a.v[i], b.v[i] ); }
+        return r;
+    }
+
+    static Float8 max( const Float8& a, const Float8& b )
+    {
+        Float8 r;
+        for ( int i = 0; i < 8; i++ ) { r.v[i] = std::max( a.v[i], b.v[i] ); }
+        return r;
+    }
+
+    Float8 abs() const
+    {
+        Float8 r;
+        for ( int i = 0; i < 8; i++ ) { r.v[i] = std::abs( v[i] ); }
+        return r;
+    }
+
+    bool isZero() const
+    {
+        for ( int i = 0; i < 8; i++ ) {
+            if ( v[i] != 0.0f ) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    float sum() const
+    {
+        float s = 0.0f;
+        for ( int i = 0; i < 8; i++ ) { s += v[i]; }
+        return s;
+    }
+
+#endif
+};
+
+#endif /*__SIMD_FLOAT8_HPP__*/
@@ -0,0 +1,295 @@
+#ifndef __SEQUENTIAL_IMPULSE_SOLVER_HPP__
+#define __SEQUENTIAL_IMPULSE_SOLVER_HPP__
+
+#include <vector>
+#include <limits>
+#include <algorithm>
+
+#include "Vec2.hpp"
+#include "MLCPConvergencePolicy.hpp"
+
+template<class T>
+class SequentialImpulseSolver {
+
+    // Solves the same problem as MLCPSolverVanillaPGS
+    //
+    //   M z + q = w,  M = J W J^T + sigma I
+    //
+    // without forming M. The solver keeps the velocity change of each body
+    //
+    //   dv_b = W_b sum_j n_j(b) z_j
+    //
+    // so that a row of M z + q is evaluated in O(1).
+    //
+    //   w_i = q_i + n0_i . dv_b0 + n1_i . dv_b1 + sigma z_i
+    //
+    // The iteration formula is the same Gauss-Seidel as the PGS, with the
+    // effective mass 1 / M_ii precomputed per row. A sweep costs O(m).
+    // The termination is decided by MLCPConvergencePolicy in the same way.
+
+public:
+
+    SequentialImpulseSolver(
+        const T       epsilon,
+        const int32_t max_num_iterations,
+        const int32_t max_stagnation
+    )
+        :m_policy             { epsilon, max_num_iterations, max_stagnation }
+        ,m_dim                { 0 }
+        ,m_iterations         { 0 }
+        ,m_status             { MLCPConvergencePolicy<T>::Continue }
+    {
+        static_assert(    std::is_same< float, T >::value
+                       || std::is_same< double,T >::value );
+    }
+
+    ~SequentialImpulseSolver()
+    {
+    }
+
+    void prepare( const int32_t num_bodies, const int32_t dim )
+    {
+        m_dim = dim;
+        m_error_history.clear();
+        m_iterations = 0;
+        m_status     = MLCPConvergencePolicy<T>::Continue;
+
+        m_mass_inv.assign( num_bodies, 0.0 );
+        m_dv_x.assign    ( num_bodies, 0.0 );
+        m_dv_y.assign    ( num_bodies, 0.0 );
+
+        m_body_0.assign  ( dim, -1 );
+        m_body_1.assign  ( dim, -1 );
+        m_n0_x.assign    ( dim, 0.0 );
+        m_n0_y.assign    ( dim, 0.0 );
+        m_n1_x.assign    ( dim, 0.0 );
+        m_n1_y.assign    ( dim, 0.0 );
+        m_cfm.assign     ( dim, 0.0 );
+        m_eff_mass.assign( dim, 0.0 );
+        m_q.assign       ( dim, 0.0 );
+        m_z.assign       ( dim, 0.0 );
+        m_z_lo.assign    ( dim, 0.0 );
+        m_z_hi.assign    ( dim, 0.0 );
+    }
+
+    void setBody( const int32_t b, const T mass_inv )
+    {
+        m_mass_inv[ b ] = mass_inv;
+    }
+
+    // b0 and b1 are the body indices given to setBody(), or -1 if none.
+    // The bodies must be set before the rows.
+    void setRow(
+        const int32_t i,
+        const int32_t b0,
+        const Vec2&   n0,
+        const int32_t b1,
+        const Vec2&   n1,
+        const T       cfm
+    ) {
+        m_body_0[ i ] = b0;
+        m_body_1[ i ] = b1;
+        m_n0_x[ i ]   = n0.x;
+        m_n0_y[ i ]   = n0.y;
+        m_n1_x[ i ]   = n1.x;
+        m_n1_y[ i ]   = n1.y;
+        m_cfm[ i ]    = cfm;
+
+        T M_ii = cfm;
+
+        if ( b0 >= 0 ) {
+            M_ii += ( m_n0_x[ i ] * m_n0_x[ i ] + m_n0_y[ i ] * m_n0_y[ i ] ) * m_mass_inv[ b0 ];
+        }
+
+        if ( b1 >= 0 ) {
+            M_ii += ( m_n1_x[ i ] * m_n1_x[ i ] + m_n1_y[ i ] * m_n1_y[ i ] ) * m_mass_inv[ b1 ];
+        }
+
+        m_eff_mass[ i ] = 1.0 / M_ii;
+    }
+
+    void setNoLimits( const int32_t i )
+    {
+        m_z_lo[i] = -1.0 * std::numeric_limits<T>::max();
+        m_z_hi[i] = std::numeric_limits<T>::max();
+    }
+
+    void setUnilateralLimits( const int32_t i )
+    {
+        m_z_lo[i] = 0.0;
+        m_z_hi[i] = std::numeric_limits<T>::max();
+    }
+
+    void setLimits( const int32_t i, const T lo, const T hi )
+    {
+        m_z_lo[i] = lo;
+        m_z_hi[i] = hi;
+    }
+
+    void setQ( const int32_t i, const T v )
+    {
+        m_q[ i ] = v;
+    }
+
+    // Initial value for warm starting. It must be within the limits.
+    void setInitialZ( const int32_t i, const T v )
+    {
+        m_z[ i ] = v;
+    }
+
+    void run()
+    {
+        initVelocityChanges();
+
+        m_policy.start();
+        m_status = MLCPConvergencePolicy<T>::Continue;
+
+        for ( m_iterations = 0; m_status == MLCPConvergencePolicy<T>::Continue; m_iterations++ ) {
+
+            const bool check = m_policy.isCheckIteration( m_iterations );
+
+            const T error = calcZ( check );
+
+            if ( check ) {
+                m_error_history.push_back( error );
+            }
+
+            m_status = m_policy.update( m_iterations, error );
+        }
+    }
+
+    const T getZ( const int32_t i ) const
+    {
+        return m_z[i];
+    }
+
+    T getError() const
+    {
+        if ( m_error_history.empty() ) {
+            return 0.0;
+        }
+        return *m_error_history.rbegin();
+    }
+
+    int32_t getIterations() const
+    {
+        return m_iterations;
+    }
+
+    typename MLCPConvergencePolicy<T>::Status getStatus() const
+    {
+        return m_status;
+    }
+
+    MLCPConvergencePolicy<T>& convergencePolicy()
+    {
+        return m_policy;
+    }
+
+private:
+
+    void initVelocityChanges()
+    {
+        std::fill( m_dv_x.begin(), m_dv_x.end(), 0.0 );
+        std::fill( m_dv_y.begin(), m_dv_y.end(), 0.0 );
+
+        for ( int32_t row = 0; row < m_dim; row++ ) {
+
+            addVelocityChanges( row, m_z[ row ] );
+        }
+    }
+
+    void addVelocityChanges( const int32_t row, const T dz )
+    {
+        const auto b0 = m_body_0[ row ];
+        if ( b0 >= 0 ) {
+            m_dv_x[ b0 ] += m_n0_x[ row ] * dz * m_mass_inv[ b0 ];
+            m_dv_y[ b0 ] += m_n0_y[ row ] * dz * m_mass_inv[ b0 ];
+        }
+
+        const auto b1 = m_body_1[ row ];
+        if ( b1 >= 0 ) {
+            m_dv_x[ b1 ] += m_n1_x[ row ] * dz * m_mass_inv[ b1 ];
+            m_dv_y[ b1 ] += m_n1_y[ row ] * dz * m_mass_inv[ b1 ];
+        }
+    }
+
+    T calcW( const int32_t i ) const
+    {
+        T w = m_q[ i ] + m_cfm[ i ] * m_z[ i ];
+
+        const auto b0 = m_body_0[ i ];
+        if ( b0 >= 0 ) {
+            w += m_n0_x[ i ] * m_dv_x[ b0 ] + m_n0_y[ i ] * m_dv_y[ b0 ];
+        }
+
+        const auto b1 = m_body_1[ i ];
+        if ( b1 >= 0 ) {
+            w += m_n1_x[ i ] * m_dv_x[ b1 ] + m_n1_y[ i ] * m_dv_y[ b1 ];
+        }
+
+        return w;
+    }
+
+    // Returns the error if requested. See MLCPSolverVanillaPGS::calcZ().
+    T calcZ( const bool calc_error )
+    {
+        T error = 0.0;
+
+        for ( int32_t row = 0; row < m_dim; row++ ) {
+
+            const T z_prev = m_z[ row ];
+
+            m_z[ row ] = clamp(
+                z_prev - calcW( row ) * m_eff_mass[ row ],
+                m_z_lo[ row ],
+                m_z_hi[ row ]
+            );
+
+            const T dz = m_z[ row ] - z_prev;
+
+            addVelocityChanges( row, dz );
+
+            if ( calc_error ) {
+                error += std::abs( dz ) / m_eff_mass[ row ];
+            }
+        }
+
+        return error;
+    }
+
+    T clamp( const T val, const T lo, const T hi )
+    {
+        return std::min ( std::max ( val, lo ), hi );
+    }
+
+    MLCPConvergencePolicy<T>
+                         m_policy;
+    std::vector<T>       m_error_history;
+
+    int32_t              m_dim;
+    int32_t              m_iterations;
+    typename MLCPConvergencePolicy<T>::Status
+                         m_status;
+
+    // per body
+    std::vector<T>       m_mass_inv;
+    std::vector<T>       m_dv_x;
+    std::vector<T>       m_dv_y;
+
+    // per row
+    std::vector<int32_t> m_body_0;
+    std::vector<int32_t> m_body_1;
+    std::vector<T>       m_n0_x;
+    std::vector<T>       m_n0_y;
+    std::vector<T>       m_n1_x;
+    std::vector<T>       m_n1_y;
+    std::vector<T>       m_cfm;
+    std::vector<T>       m_eff_mass;
+    std::vector<T>       m_q;
+    std::vector<T>       m_z;
+    std::vector<T>       m_z_lo;
+    std::vector<T>       m_z_hi;
+};
+
+#endif /*__SEQUENTIAL_IMPULSE_SOLVER_HPP__*/
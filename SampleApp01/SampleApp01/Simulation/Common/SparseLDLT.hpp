@@ -0,0 +1,230 @@
+#ifndef __SPARSE_LDLT_HPP__
+#define __SPARSE_LDLT_HPP__
+
+#include <vector>
+#include <queue>
+#include <functional>
+#include <cstdint>
+
+template<class T>
+class SparseLDLT {
+
+    // LDL^T factorization of a sparse symmetric positive definite matrix
+    //
+    //   P A P^T = L D L^T
+    //
+    // The elimination order P is the minimum degree order. For the matrices
+    // whose graph is a path or a tree, such as the bilateral constraints of
+    // the chains, it eliminates the leaves first and creates no fill-in,
+    // hence both factorize() and solve() are O(n).
+    // For the other graphs the fill-in is added as the elimination proceeds.
+    //
+    // The entries are appended in any order. Only the lower triangle (j <= i)
+    // is read, so the symmetric matrix can be appended in full.
+
+public:
+
+    SparseLDLT()
+        :m_dim{ 0 }
+    {
+        static_assert(    std::is_same< float, T >::value
+                       || std::is_same< double,T >::value );
+    }
+
+    ~SparseLDLT()
+    {
+    }
+
+    void reset( const int32_t dim )
+    {
+        m_dim = dim;
+
+        if ( (int32_t)m_adjacency.size() < dim ) {
+            m_adjacency.resize( dim );
+        }
+        for ( int32_t i = 0; i < dim; i++ ) {
+            m_adjacency[ i ].clear();
+        }
+        m_diag.assign( dim, 0.0 );
+    }
+
+    void append( const int32_t i, const int32_t j, const T v )
+    {
+        if ( i == j ) {
+            m_diag[ i ] = v;
+        }
+        else if ( j < i ) {
+            m_adjacency[ i ].push_back( Entry{ j, v } );
+            m_adjacency[ j ].push_back( Entry{ i, v } );
+        }
+    }
+
+    void factorize()
+    {
+        m_order.clear();
+        m_D.clear();
+        m_L_begin.assign( 1, 0 );
+        m_L.clear();
+        m_eliminated.assign( m_dim, false );
+
+        std::priority_queue< Degree, std::vector< Degree >, std::greater< Degree > > queue;
+
+        for ( int32_t i = 0; i < m_dim; i++ ) {
+
+            queue.push( Degree{ (int32_t)m_adjacency[ i ].size(), i } );
+        }
+
+        while ( !queue.empty() ) {
+
+            const auto top = queue.top();
+            queue.pop();
+
+            const auto p = top.second;
+
+            // lazy deletion of the outdated degrees.
+            if ( m_eliminated[ p ] || top.first != (int32_t)m_adjacency[ p ].size() ) {
+                continue;
+            }
+
+            eliminate( p );
+
+            for ( const auto& e : m_adjacency[ p ] ) {
+
+                queue.push( Degree{ (int32_t)m_adjacency[ e.m_index ].size(), e.m_index } );
+            }
+            m_adjacency[ p ].clear();
+        }
+    }
+
+    // Solves A x = b in place. x holds b on entry.
+    void solve( T* x ) const
+    {
+        const auto n = (int32_t)m_order.size();
+
+        for ( int32_t k = 0; k < n; k++ ) {
+
+            const auto x_p = x[ m_order[ k ] ];
+
+            for ( int32_t l = m_L_begin[ k ]; l < m_L_begin[ k + 1 ]; l++ ) {
+
+                x[ m_L[ l ].m_index ] -= m_L[ l ].m_value * x_p;
+            }
+        }
+
+        for ( int32_t k = 0; k < n; k++ ) {
+
+            x[ m_order[ k ] ] /= m_D[ k ];
+        }
+
+        for ( int32_t k = n - 1; k >= 0; k-- ) {
+
+            T x_p = x[ m_order[ k ] ];
+
+            for ( int32_t l = m_L_begin[ k ]; l < m_L_begin[ k + 1 ]; l++ ) {
+
+                x_p -= m_L[ l ].m_value * x[ m_L[ l ].m_index ];
+            }
+            x[ m_order[ k ] ] = x_p;
+        }
+    }
+
+private:
+
+    struct Entry {
+        int32_t m_index;
+        T       m_value;
+    };
+
+    typedef std::pair< int32_t, int32_t > Degree;
+
+    // Eliminates p and updates the remaining matrix with the Schur complement
+    //
+    //   A_ab -= A_ap A_pb / A_pp  for the neighbors a and b of p.
+    void eliminate( const int32_t p )
+    {
+        m_eliminated[ p ] = true;
+
+        const auto& neighbors = m_adjacency[ p ];
+        const T     D_p       = m_diag[ p ];
+
+        m_order.push_back( p );
+        m_D.push_back( D_p );
+
+        for ( const auto& e : neighbors ) {
+
+            m_L.push_back( Entry{ e.m_index, e.m_value / D_p } );
+
+            removeEntry( e.m_index, p );
+
+            m_diag[ e.m_index ] -= e.m_value * e.m_value / D_p;
+        }
+        m_L_begin.push_back( (int32_t)m_L.size() );
+
+        for ( size_t ia = 0; ia < neighbors.size(); ia++ ) {
+
+            for ( size_t ib = ia + 1; ib < neighbors.size(); ib++ ) {
+
+                addEntry(
+                    neighbors[ ia ].m_index,
+                    neighbors[ ib ].m_index,
+                    -1.0 * neighbors[ ia ].m_value * neighbors[ ib ].m_value / D_p
+                );
+            }
+        }
+    }
+
+    void removeEntry( const int32_t a, const int32_t b )
+    {
+        auto& entries = m_adjacency[ a ];
+
+        for ( size_t k = 0; k < entries.size(); k++ ) {
+
+            if ( entries[ k ].m_index == b ) {
+
+                entries[ k ] = entries.back();
+                entries.pop_back();
+                return;
+            }
+        }
+    }
+
+    // Adds v to A_ab and A_ba, creating a fill-in if they are zero.
+    void addEntry( const int32_t a, const int32_t b, const T v )
+    {
+        for ( auto& e : m_adjacency[ a ] ) {
+
+            if ( e.m_index == b ) {
+
+                e.m_value += v;
+
+                for ( auto& f : m_adjacency[ b ] ) {
+
+                    if ( f.m_index == a ) {
+                        f.m_value += v;
+                        break;
+                    }
+                }
+                return;
+            }
+        }
+
+        m_adjacency[ a ].push_back( Entry{ b, v } );
+        m_adjacency[ b ].push_back( Entry{ a, v } );
+    }
+
+    int32_t                           m_dim;
+
+    // The remaining matrix during the elimination.
+    std::vector< std::vector<Entry> > m_adjacency;
+    std::vector<T>                    m_diag;
+    std::vector<bool>                 m_eliminated;
+
+    // The factor. The k-th eliminated row is m_order[k], whose pivot is m_D[k]
+    // and whose column of L is m_L[ m_L_begin[k] ... m_L_begin[k+1]-1 ].
+    std::vector<int32_t>              m_order;
+    std::vector<T>                    m_D;
+    std::vector<int32_t>              m_L_begin;
+    std::vector<Entry>                m_L;
+};
+
+#endif /*__SPARSE_LDLT_HPP__*/
@@ -0,0 +1,121 @@
+#ifndef __SPARSE_MATRIX_CSR_HPP__
+#define __SPARSE_MATRIX_CSR_HPP__
+
+#include <vector>
+#include <cstdint>
+
+template<class T>
+class SparseMatrixCSR {
+
+    // Square sparse matrix in the compressed sparse row format.
+    //
+    // The entries are appended row by row in the increasing order of the rows.
+    // Each (i, j) must be appended at most once. The columns in a row can be
+    // in any order. finish() must be called before the matrix is read.
+
+public:
+
+    SparseMatrixCSR()
+        :m_dim      { 0 }
+        ,m_last_row { -1 }
+    {
+        static_assert(    std::is_same< float, T >::value
+                       || std::is_same< double,T >::value );
+    }
+
+    ~SparseMatrixCSR()
+    {
+    }
+
+    void reset( const int32_t dim )
+    {
+        m_dim      = dim;
+        m_last_row = -1;
+
+        m_row_begin.resize( dim + 1 );
+        m_diag_index.assign( dim, -1 );
+        m_cols.clear();
+        m_vals.clear();
+    }
+
+    void append( const int32_t i, const int32_t j, const T v )
+    {
+        for ( ; m_last_row < i; m_last_row++ ) {
+
+            m_row_begin[ m_last_row + 1 ] = (int32_t)m_cols.size();
+        }
+
+        if ( i == j ) {
+            m_diag_index[ i ] = (int32_t)m_cols.size();
+        }
+
+        m_cols.push_back( j );
+        m_vals.push_back( v );
+    }
+
+    void finish()
+    {
+        for ( ; m_last_row < m_dim; m_last_row++ ) {
+
+            m_row_begin[ m_last_row + 1 ] = (int32_t)m_cols.size();
+        }
+    }
+
+    int32_t dim() const
+    {
+        return m_dim;
+    }
+
+    int32_t numNonZeros() const
+    {
+        return (int32_t)m_cols.size();
+    }
+
+    int32_t rowBegin( const int32_t i ) const
+    {
+        return m_row_begin[ i ];
+    }
+
+    int32_t rowEnd( const int32_t i ) const
+    {
+        return m_row_begin[ i + 1 ];
+    }
+
+    int32_t col( const int32_t k ) const
+    {
+        return m_cols[ k ];
+    }
+
+    T val( const int32_t k ) const
+    {
+        return m_vals[ k ];
+    }
+
+    T diagonal( const int32_t i ) const
+    {
+        const auto k = m_diag_index[ i ];
+        return ( k >= 0 ) ? m_vals[ k ] : 0.0;
+    }
+
+    T rowDot( const int32_t i, const T* x ) const
+    {
+        T dot = 0.0;
+
+        for ( int32_t k = m_row_begin[ i ]; k < m_row_begin[ i + 1 ]; k++ ) {
+
+            dot += m_vals[ k ] * x[ m_cols[ k ] ];
+        }
+        return dot;
+    }
+
+private:
+
+    int32_t              m_dim;
+    int32_t              m_last_row;
+    std::vector<int32_t> m_row_begin;
+    std::vector<int32_t> m_diag_index;
+    std::vector<int32_t> m_cols;
+    std::vector<T>       m_vals;
+};
+
+#endif /*__SPARSE_MATRIX_CSR_HPP__*/
@@ -0,0 +1,289 @@
+#ifndef __SWEEP_AND_PRUNE_BROADPHASE_HPP__
+#define __SWEEP_AND_PRUNE_BROADPHASE_HPP__
+
+#include <vector>
+#include <array>
+#include <utility>
+#include <algorithm>
+#include <iterator>
+#include <cstdint>
+#include <cmath>
+
+#include "Vec2.hpp"
+#include "Broadphase.hpp"
+
+class SweepAndPruneBroadphase : public Broadphase {
+
+    // Finds the candidate pairs with the sweep and prune, keeping the sorted
+    // end points of the intervals along x and y and the pairs of the
+    // overlapping boxes between the calls, for the discs that move little
+    // per step.
+    //
+    // The end points are repaired with the insertion sort. An end point of
+    // a disc moves over that of another disc only when their intervals start
+    // or stop overlapping on the axis, and such pairs are checked against the
+    // new order and added to or removed from the overlapping pairs.
+    // The cost per call is O(n + the number of the swaps + the number of the
+    // overlapping pairs) instead of O(n log n).
+    //
+    // Two intervals overlap if the min of each comes before the max of the
+    // other in the order. The min comes before the max of the same value, so
+    // that the touching intervals overlap.
+    //
+    // The state is rebuilt with the sweep along x when the number of the discs
+    // changes. The filter is applied to the overlapping pairs on the output,
+    // so that they do not depend on it.
+
+public:
+
+    SweepAndPruneBroadphase()
+        :m_num_discs{ 0 }
+    {
+    }
+
+    virtual ~SweepAndPruneBroadphase()
+    {
+    }
+
+    void findPairs(
+        const std::vector< Vec2 >&                    centers,
+        const std::vector< float >&                   radii,
+        const float                                   margin,
+        std::vector< std::pair< int32_t, int32_t > >& pairs
+    ) override {
+        pairs.clear();
+
+        if ( (int32_t)centers.size() != m_num_discs ) {
+            rebuild( centers, radii, margin );
+        }
+        else {
+            repair( centers, radii, margin );
+        }
+
+        for ( const auto& p : m_overlaps ) {
+
+            const auto reach = radii[ p.first ] + radii[ p.second ] + margin;
+
+            if (    std::abs( centers[ p.first ].x - centers[ p.second ].x ) <= reach
+                 && std::abs( centers[ p.first ].y - centers[ p.second ].y ) <= reach
+                 && accepts( p.first, p.second )
+            ) {
+                pairs.push_back( p );
+            }
+        }
+    }
+
+private:
+
+    struct EndPoint {
+
+        float   m_value;
+        int32_t m_index;
+        bool    m_is_min;
+    };
+
+    static bool before( const EndPoint& a, const EndPoint& b )
+    {
+        return a.m_value < b.m_value || ( a.m_value == b.m_value && a.m_is_min && !b.m_is_min );
+    }
+
+    static std::pair< int32_t, int32_t > orderedPair( const int32_t i, const int32_t j )
+    {
+        return ( i < j ) ? std::make_pair( i, j ) : std::make_pair( j, i );
+    }
+
+    static float value(
+        const Vec2&   center,
+        const float   radius,
+        const float   margin,
+        const int32_t axis,
+        const bool    is_min
+    ) {
+        const auto c    = ( axis == 0 ) ? center.x : center.y;
+        const auto half = radius + 0.5f * margin;
+
+        return is_min ? ( c - half ) : ( c + half );
+    }
+
+    bool overlapping( const std::pair< int32_t, int32_t >& p ) const
+    {
+        for ( int32_t axis = 0; axis < 2; axis++ ) {
+
+            if (    m_max_pos[ axis ][ p.second ] < m_min_pos[ axis ][ p.first  ]
+                 || m_max_pos[ axis ][ p.first  ] < m_min_pos[ axis ][ p.second ]
+            ) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    void rebuild( const std::vector< Vec2 >& centers, const std::vector< float >& radii, const float margin )
+    {
+        m_num_discs = (int32_t)centers.size();
+
+        for ( int32_t axis = 0; axis < 2; axis++ ) {
+
+            auto& end_points = m_end_points[ axis ];
+
+            end_points.clear();
+
+            for ( int32_t i = 0; i < m_num_discs; i++ ) {
+
+                end_points.push_back( EndPoint{ value( centers[ i ], radii[ i ], margin, axis, true  ), i, true  } );
+                end_points.push_back( EndPoint{ value( centers[ i ], radii[ i ], margin, axis, false ), i, false } );
+            }
+
+            std::sort( end_points.begin(), end_points.end(), before );
+
+            updatePositions( axis );
+        }
+
+        m_overlaps.clear();
+        m_active.clear();
+        m_active_pos.resize( m_num_discs );
+
+        for ( const auto& e : m_end_points[ 0 ] ) {
+
+            if ( e.m_is_min ) {
+
+                for ( const auto a : m_active ) {
+
+                    const auto p = orderedPair( a, e.m_index );
+
+                    if ( overlapping( p ) ) {
+                        m_overlaps.push_back( p );
+                    }
+                }
+
+                m_active_pos[ e.m_index ] = (int32_t)m_active.size();
+                m_active.push_back( e.m_index );
+            }
+            else {
+                const auto pos = m_active_pos[ e.m_index ];
+
+                m_active[ pos ] = m_active.back();
+                m_active_pos[ m_active[ pos ] ] = pos;
+                m_active.pop_back();
+            }
+        }
+
+        std::sort( m_overlaps.begin(), m_overlaps.end() );
+    }
+
+    void repair( const std::vector< Vec2 >& centers, const std::vector< float >& radii, const float margin )
+    {
+        m_touched.clear();
+
+        for ( int32_t axis = 0; axis < 2; axis++ ) {
+
+            auto& end_points = m_end_points[ axis ];
+
+            for ( auto& e : end_points ) {
+
+                e.m_value = value( centers[ e.m_index ], radii[ e.m_index ], margin, axis, e.m_is_min );
+            }
+
+            const auto num_touched = m_touched.size();
+
+            for ( int32_t k = 1; k < (int32_t)end_points.size(); k++ ) {
+
+                const auto e = end_points[ k ];
+                auto       l = k;
+
+                for ( ; l > 0 && before( e, end_points[ l - 1 ] ); l-- ) {
+
+                    const auto& f = end_points[ l - 1 ];
+
+                    if ( e.m_is_min != f.m_is_min && e.m_index != f.m_index ) {
+                        m_touched.push_back( orderedPair( e.m_index, f.m_index ) );
+                    }
+                    end_points[ l ] = f;
+                }
+                end_points[ l ] = e;
+            }
+
+            if ( m_touched.size() != num_touched ) {
+                updatePositions( axis );
+            }
+        }
+
+        if ( m_touched.empty() ) {
+            return;
+        }
+
+        // A pair can be touched more than once, e.g., a disc passing over another.
+        std::sort( m_touched.begin(), m_touched.end() );
+        m_touched.erase( std::unique( m_touched.begin(), m_touched.end() ), m_touched.end() );
+
+        m_added.clear();
+        m_removed.clear();
+
+        for ( const auto& p : m_touched ) {
+
+            const bool overlap = overlapping( p );
+            const bool present = std::binary_search( m_overlaps.begin(), m_overlaps.end(), p );
+
+            if ( overlap && !present ) {
+                m_added.push_back( p );
+            }
+            else if ( !overlap && present ) {
+                m_removed.push_back( p );
+            }
+        }
+
+        if ( m_added.empty() && m_removed.empty() ) {
+            return;
+        }
+
+        m_kept.clear();
+        std::set_difference(
+            m_overlaps.begin(), m_overlaps.end(), m_removed.begin(), m_removed.end(), std::back_inserter( m_kept )
+        );
+
+        m_overlaps.clear();
+        std::merge(
+            m_kept.begin(), m_kept.end(), m_added.begin(), m_added.end(), std::back_inserter( m_overlaps )
+        );
+    }
+
+    void updatePositions( const int32_t axis )
+    {
+        const auto& end_points = m_end_points[ axis ];
+
+        m_min_pos[ axis ].resize( m_num_discs );
+        m_max_pos[ axis ].resize( m_num_discs );
+
+        for ( int32_t k = 0; k < (int32_t)end_points.size(); k++ ) {
+
+            const auto& e = end_points[ k ];
+
+            if ( e.m_is_min ) {
+                m_min_pos[ axis ][ e.m_index ] = k;
+            }
+            else {
+                m_max_pos[ axis ][ e.m_index ] = k;
+            }
+        }
+    }
+
+    int32_t                                        m_num_discs;
+
+    // along x and y.
+    std::array< std::vector< EndPoint >, 2 >       m_end_points;
+    std::array< std::vector< int32_t >, 2 >        m_min_pos;
+    std::array< std::vector< int32_t >, 2 >        m_max_pos;
+
+    // sorted by the first and then the second.
+    std::vector< std::pair< int32_t, int32_t > >   m_overlaps;
+
+    // work memory
+    std::vector< int32_t >                         m_active;
+    std::vector< int32_t >                         m_active_pos;
+    std::vector< std::pair< int32_t, int32_t > >   m_touched;
+    std::vector< std::pair< int32_t, int32_t > >   m_added;
+    std::vector< std::pair< int32_t, int32_t > >   m_removed;
+    std::vector< std::pair< int32_t, int32_t > >   m_kept;
+};
+
+#endif /*__SWEEP_AND_PRUNE_BROADPHASE_HPP__*/
@@ -0,0 +1,135 @@
+#ifndef __THREAD_POOL_HPP__
+#define __THREAD_POOL_HPP__
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+
+class ThreadPool {
+
+    // Runs the tasks 0 .. num_tasks-1 of a job on the worker threads and the
+    // calling thread, and returns when all of them have finished.
+    // The tasks are taken in the increasing order of the indices, so the caller
+    // should put the heavier tasks first (largest-first scheduling).
+
+public:
+
+    static int32_t defaultNumWorkers()
+    {
+        const auto n = (int32_t)std::thread::hardware_concurrency();
+        return ( n > 1 ) ? n - 1 : 0;
+    }
+
+    ThreadPool( const int32_t num_workers )
+        :m_terminate     { false }
+        ,m_generation    { 0 }
+        ,m_task          { nullptr }
+        ,m_num_tasks     { 0 }
+        ,m_next_task     { 0 }
+        ,m_num_busy      { 0 }
+    {
+        for ( int32_t i = 0; i < num_workers; i++ ) {
+
+            m_workers.emplace_back( [this]{ workerLoop(); } );
+        }
+    }
+
+    ~ThreadPool()
+    {
+        {
+            std::lock_guard< std::mutex > lock( m_mutex );
+            m_terminate = true;
+        }
+        m_cv_start.notify_all();
+
+        for ( auto& w : m_workers ) {
+            w.join();
+        }
+    }
+
+    // Number of the threads including the calling thread.
+    int32_t numThreads() const
+    {
+        return (int32_t)m_workers.size() + 1;
+    }
+
+    void run( const int32_t num_tasks, const std::function< void( const int32_t ) >& task )
+    {
+        if ( m_workers.empty() || num_tasks <= 1 ) {
+
+            for ( int32_t i = 0; i < num_tasks; i++ ) {
+                task( i );
+            }
+            return;
+        }
+
+        {
+            std::lock_guard< std::mutex > lock( m_mutex );
+            m_task      = &task;
+            m_num_tasks = num_tasks;
+            m_next_task = 0;
+            m_num_busy  = (int32_t)m_workers.size();
+            m_generation++;
+        }
+        m_cv_start.notify_all();
+
+        runTasks();
+
+        std::unique_lock< std::mutex > lock( m_mutex );
+        m_cv_done.wait( lock, [this]{ return m_num_busy == 0; } );
+        m_task = nullptr;
+    }
+
+private:
+
+    void workerLoop()
+    {
+        int64_t generation = 0;
+
+        std::unique_lock< std::mutex > lock( m_mutex );
+
+        while ( true ) {
+
+            m_cv_start.wait( lock, [this, generation]{ return m_terminate || m_generation != generation; } );
+
+            if ( m_terminate ) {
+                return;
+            }
+            generation = m_generation;
+
+            lock.unlock();
+            runTasks();
+            lock.lock();
+
+            if ( --m_num_busy == 0 ) {
+                m_cv_done.notify_one();
+            }
+        }
+    }
+
+    void runTasks()
+    {
+        for ( int32_t i = m_next_task++; i < m_num_tasks; i = m_next_task++ ) {
+
+            (*m_task)( i );
+        }
+    }
+
+    std::vector< std::thread > m_workers;
+    std::mutex                 m_mutex;
+    std::condition_variable    m_cv_start;
+    std::condition_variable    m_cv_done;
+    bool                       m_terminate;
+    int64_t                    m_generation;
+
+    const std::function< void( const int32_t ) >*
+                               m_task;
+    int32_t                    m_num_tasks;
+    std::atomic< int32_t >     m_next_task;
+    int32_t                    m_num_busy;
+};
+
+#endif /*__THREAD_POOL_HPP__*/
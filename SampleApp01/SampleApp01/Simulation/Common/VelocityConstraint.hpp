@@ -18,15 +18,17 @@ public:
         RigidBody* body_1,
         Vec2       n0,
         Vec2       n1,
-        float      b
+        float      b,
+        int32_t    feature_id = -1
     )
-        :m_type   { type }
-        ,m_body_0 { body_0 }
-        ,m_body_1 { body_1 }
-        ,m_n0     { n0 }
-        ,m_n1     { n1 }
-        ,m_b      { b }
-        ,m_lambda { 0.0f }
+        :m_type       { type }
+        ,m_body_0     { body_0 }
+        ,m_body_1     { body_1 }
+        ,m_n0         { n0 }
+        ,m_n1         { n1 }
+        ,m_b          { b }
+        ,m_lambda     { 0.0f }
+        ,m_feature_id { feature_id }
     {
     }
 
@@ -37,6 +39,10 @@ public:
     Vec2       m_n1;
     float      m_b;
     float      m_lambda;
+
+    // Identifies the constraint between the same pair of bodies across the frames,
+    // e.g. the wall for the contacts against the walls. -1 if not used.
+    int32_t    m_feature_id;
 };
 
 #endif /*__VELOCITY_CONSTRAINT_HPP__*/
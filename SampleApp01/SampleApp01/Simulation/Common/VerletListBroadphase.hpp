@@ -0,0 +1,136 @@
+#ifndef __VERLET_LIST_BROADPHASE_HPP__
+#define __VERLET_LIST_BROADPHASE_HPP__
+
+#include <vector>
+#include <memory>
+#include <utility>
+#include <cstdint>
+#include <cmath>
+
+#include "Vec2.hpp"
+#include "Broadphase.hpp"
+
+class VerletListBroadphase : public Broadphase {
+
+    // Finds the candidate pairs from the Verlet neighbor lists, i.e., the
+    // pairs found by another broadphase with the margin enlarged by the skin,
+    // which are kept over the steps.
+    //
+    // The lists are rebuilt only when some disc has moved more than half the
+    // skin since the last build, or the number of the discs has changed.
+    // Until then any pair within the margin is in the lists, as each of the
+    // two discs has moved by at most half the skin. In the other steps the
+    // cost is O(n) for the displacements plus O(the size of the lists).
+    //
+    // The lists are the pairs sorted by i and then j, i.e., the neighbors of
+    // each disc i are contiguous. The radii must not change between the builds.
+    //
+    // The filter is applied by the other broadphase, and the lists are rebuilt
+    // when the filter changes.
+
+public:
+
+    VerletListBroadphase( std::unique_ptr< Broadphase > builder, const float skin )
+        :m_builder       { std::move( builder ) }
+        ,m_skin          { skin }
+        ,m_num_builds    { 0 }
+        ,m_stale         { true }
+        ,m_built_margin  { 0.0f }
+        ,m_built_version { 0 }
+    {
+    }
+
+    virtual ~VerletListBroadphase()
+    {
+    }
+
+    void setFilter( const CollisionFilter* filter ) override
+    {
+        Broadphase::setFilter( filter );
+        m_builder->setFilter( filter );
+        m_stale = true;
+    }
+
+    void findPairs(
+        const std::vector< Vec2 >&                    centers,
+        const std::vector< float >&                   radii,
+        const float                                   margin,
+        std::vector< std::pair< int32_t, int32_t > >& pairs
+    ) override {
+        pairs.clear();
+
+        if ( needsRebuild( centers, margin ) ) {
+
+            m_builder->findPairs( centers, radii, margin + m_skin, m_neighbors );
+
+            m_built_centers = centers;
+            m_built_margin  = margin;
+            m_built_version = filterVersion();
+            m_stale         = false;
+            m_num_builds++;
+        }
+
+        for ( const auto& p : m_neighbors ) {
+
+            const auto reach = radii[ p.first ] + radii[ p.second ] + margin;
+
+            if (    std::abs( centers[ p.first ].x - centers[ p.second ].x ) <= reach
+                 && std::abs( centers[ p.first ].y - centers[ p.second ].y ) <= reach
+            ) {
+                pairs.push_back( p );
+            }
+        }
+    }
+
+    // The number of the builds of the lists so far.
+    int32_t numBuilds() const
+    {
+        return m_num_builds;
+    }
+
+    const std::vector< std::pair< int32_t, int32_t > >& neighbors() const
+    {
+        return m_neighbors;
+    }
+
+private:
+
+    bool needsRebuild( const std::vector< Vec2 >& centers, const float margin ) const
+    {
+        if (    m_stale
+             || centers.size() != m_built_centers.size()
+             || margin         != m_built_margin
+             || filterVersion() != m_built_version
+        ) {
+            return true;
+        }
+
+        const auto limit_sq = 0.25f * m_skin * m_skin;
+
+        for ( size_t i = 0; i < centers.size(); i++ ) {
+
+            const auto d = centers[ i ] - m_built_centers[ i ];
+
+            if ( d.dot( d ) > limit_sq ) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    uint64_t filterVersion() const
+    {
+        return ( m_filter != nullptr ) ? m_filter->version() : 0;
+    }
+
+    std::unique_ptr< Broadphase >                m_builder;
+    const float                                  m_skin;
+    int32_t                                      m_num_builds;
+    bool                                         m_stale;
+    float                                        m_built_margin;
+    uint64_t                                     m_built_version;
+    std::vector< Vec2 >                          m_built_centers;
+    std::vector< std::pair< int32_t, int32_t > > m_neighbors;
+};
+
+#endif /*__VERLET_LIST_BROADPHASE_HPP__*/
@@ -4,11 +4,19 @@
 #include <vector>
 #include <random>
 #include <iostream>
+#include <memory>
+#include <unordered_map>
 
 #include "ChainedDisc.hpp"
 #include "Vec3.hpp"
 
 #include "ConstraintsSolver.hpp"
+#include "ConstraintsRecorder.hpp"
+#include "ContactCache.hpp"
+#include "HashGridBroadphase.hpp"
+#include "SweepAndPruneBroadphase.hpp"
+#include "AABBTreeBroadphase.hpp"
+#include "VerletListBroadphase.hpp"
 
 class Simulator {
 
@@ -23,13 +31,32 @@ public:
     static constexpr int   MAX_DISCS              = 100;
     static constexpr int   MAX_TRIANGLES_PER_DISC = 32;
 
+    // for the VerletList broadphase.
+    static constexpr float VERLET_SKIN            = 0.02f;
+
+    // feature ids of the contacts against the walls for ContactCache.
+    static constexpr int   WALL_LEFT              = 0;
+    static constexpr int   WALL_RIGHT             = 1;
+    static constexpr int   WALL_BOTTOM            = 2;
+    static constexpr int   WALL_TOP               = 3;
+
+    typedef enum _BroadphaseType {
+        HashGrid,      // rebuilt in each step.
+        SweepAndPrune, // incremental, for the discs that move little per step.
+        AABBTree,      // for the discs of very different sizes.
+        VerletList     // the hash grid with VERLET_SKIN, kept over the steps. the default.
+    } BroadphaseType;
+
     Simulator()
         :m_area_width        { AREA_WIDTH }
         ,m_area_height       { AREA_HEIGHT }
         ,m_area_width_target { AREA_WIDTH }
         ,m_area_height_target{ AREA_HEIGHT }
+        ,m_recorder          { nullptr }
     {
+        setBroadphase( VerletList );
         buildDiscs();
+        buildCollisionFilter();
     }
 
     ~Simulator()
@@ -45,6 +72,38 @@ public:
         m_area_height_target = height;
     }
 
+    // e.g. to apply ConstraintsSolverConfig.
+    ConstraintsSolver<float>& constraintsSolver()
+    {
+        return m_constraints_solver;
+    }
+
+    void setBroadphase( const BroadphaseType type )
+    {
+        if ( type == SweepAndPrune ) {
+            m_broadphase.reset( new SweepAndPruneBroadphase() );
+        }
+        else if ( type == AABBTree ) {
+            m_broadphase.reset( new AABBTreeBroadphase() );
+        }
+        else if ( type == VerletList ) {
+            m_broadphase.reset(
+                new VerletListBroadphase( std::unique_ptr< Broadphase >( new HashGridBroadphase() ), VERLET_SKIN )
+            );
+        }
+        else {
+            m_broadphase.reset( new HashGridBroadphase() );
+        }
+
+        m_broadphase->setFilter( &m_filter );
+    }
+
+    // The input of the constraints solver is recorded in each update() if not nullptr.
+    void setRecorder( ConstraintsRecorder* recorder )
+    {
+        m_recorder = recorder;
+    }
+
     void update( const float delta_t, const Vec2& accel, float torsional_spring_strength )
     {
         updateAreaSize();
@@ -68,11 +127,18 @@ public:
         m_constraints_solver.reset();
         for ( auto* c : m_constraints ) {
 
+            m_contact_cache.warmStart( c );
             m_constraints_solver.add( c );
         }
 
+        if ( m_recorder != nullptr ) {
+            m_recorder->record( m_constraints, delta_t );
+        }
+
         m_constraints_solver.run( delta_t );
 
+        m_contact_cache.update( m_constraints );
+
         for ( auto* c : m_constraints ) {
 
             if ( c->m_body_0 != nullptr ) {
@@ -99,14 +165,32 @@ public:
 
 private:
 
+    // The candidate pairs come from the broadphase on m_com_tmp, sorted as the
+    // loop over all the pairs, and the constraints are in the same order.
+    // The margin covers EPSILON in the test of detectCollisionPair().
+    // The pairs rejected by m_filter are not generated.
     void detectCollisions( const float delta_t )
     {
+        m_centers.resize( m_discs.size() );
+        m_radii.resize( m_discs.size() );
+        m_filter.resize( m_discs.size() );
+
         for ( int i = 0; i < m_discs.size(); i++ ) {
 
-            for ( int j = i + 1; j < m_discs.size(); j++ ) {
+            m_centers[i] = m_discs[i]->m_com_tmp;
+            m_radii[i]   = m_discs[i]->m_radius;
+            m_filter.setCategoryAndMask( i, m_discs[i]->m_category, m_discs[i]->m_mask );
+        }
+
+        m_broadphase->findPairs( m_centers, m_radii, std::sqrt( EPSILON ), m_pairs );
+
+        size_t p = 0;
+
+        for ( int i = 0; i < m_discs.size(); i++ ) {
 
-                detectCollisionPair( m_discs[i], m_discs[j], delta_t );
+            for ( ; p < m_pairs.size() && m_pairs[p].first == i; p++ ) {
 
+                detectCollisionPair( m_discs[i], m_discs[ m_pairs[p].second ], delta_t );
             }
 
             detectCollisionAgainstWalls( m_discs[i], delta_t );
@@ -115,10 +199,6 @@ private:
 
     void detectCollisionPair( ChainedDisc* d0,  ChainedDisc* d1, const float delta_t )
     {
-        if ( d0->m_next == d1 || d0->m_prev == d1 || d1->m_next == d0 || d1->m_prev == d0 ) {
-            return;
-        }
-
         const auto v_1_to_0_tmp = d0->m_com_tmp - d1->m_com_tmp;
         const auto sq_len_tmp   = v_1_to_0_tmp.sq_length();
         const auto min_dist = d0->m_radius + d1->m_radius;
@@ -146,7 +226,7 @@ private:
             const auto signed_dist = d0->m_com.x - d0->m_radius + 0.5f * m_area_width;
             const Vec2 n0{ 1.0f, 0.0f };
 
-            auto* constraint = new VelocityConstraint{ VelocityConstraint::Unilateral, d0, nullptr, n0, n0, -1.0f * signed_dist / delta_t };
+            auto* constraint = new VelocityConstraint{ VelocityConstraint::Unilateral, d0, nullptr, n0, n0, -1.0f * signed_dist / delta_t, WALL_LEFT };
             m_constraints.push_back( constraint );
         }
 
@@ -155,7 +235,7 @@ private:
             const auto signed_dist = -1.0f * ( d0->m_com.x + d0->m_radius - 0.5f * m_area_width );
             const Vec2 n0{ -1.0f, 0.0f };
 
-            auto* constraint = new VelocityConstraint{ VelocityConstraint::Unilateral, d0, nullptr, n0, n0, -1.0f * signed_dist / delta_t };
+            auto* constraint = new VelocityConstraint{ VelocityConstraint::Unilateral, d0, nullptr, n0, n0, -1.0f * signed_dist / delta_t, WALL_RIGHT };
             m_constraints.push_back( constraint );
         }
 
@@ -164,7 +244,7 @@ private:
             const auto signed_dist = d0->m_com.y - d0->m_radius + 0.5f * m_area_height;
             const Vec2 n0{ 0.0f, 1.0f };
 
-            auto* constraint = new VelocityConstraint{ VelocityConstraint::Unilateral, d0, nullptr, n0, n0, -1.0f * signed_dist / delta_t };
+            auto* constraint = new VelocityConstraint{ VelocityConstraint::Unilateral, d0, nullptr, n0, n0, -1.0f * signed_dist / delta_t, WALL_BOTTOM };
             m_constraints.push_back( constraint );
         }
 
@@ -173,7 +253,7 @@ private:
             const auto signed_dist = -1.0f * ( d0->m_com.y + d0->m_radius - 0.5f * m_area_height );
             const Vec2 n0{ 0.0f, -1.0f };
 
-            auto* constraint = new VelocityConstraint{ VelocityConstraint::Unilateral, d0, nullptr, n0, n0, -1.0f * signed_dist / delta_t };
+            auto* constraint = new VelocityConstraint{ VelocityConstraint::Unilateral, d0, nullptr, n0, n0, -1.0f * signed_dist / delta_t, WALL_TOP };
             m_constraints.push_back( constraint );
         }
     }
@@ -311,6 +391,26 @@ private:
         m_discs.push_back( p9 );
     }
 
+    // The linked discs are excluded from the collisions.
+    void buildCollisionFilter()
+    {
+        std::unordered_map< ChainedDisc*, int32_t > indices;
+
+        for ( int32_t i = 0; i < (int32_t)m_discs.size(); i++ ) {
+            indices[ m_discs[i] ] = i;
+        }
+
+        m_filter.resize( m_discs.size() );
+        m_filter.clearExclusions();
+
+        for ( int32_t i = 0; i < (int32_t)m_discs.size(); i++ ) {
+
+            if ( m_discs[i]->m_next != nullptr ) {
+                m_filter.exclude( i, indices[ m_discs[i]->m_next ] );
+            }
+        }
+    }
+
     void updateAreaSize()
     {
         // gradually change the area size.
@@ -340,7 +440,16 @@ private:
     std::vector< ChainedDisc* >        m_discs;
     std::vector< VelocityConstraint* > m_constraints;
 
-    ConstraintsSolver                  m_constraints_solver;
+    ConstraintsSolver<float>           m_constraints_solver;
+    ContactCache                       m_contact_cache;
+
+    std::unique_ptr< Broadphase >      m_broadphase;
+    CollisionFilter                    m_filter;
+    std::vector< Vec2 >                m_centers;
+    std::vector< float >               m_radii;
+    std::vector< std::pair< int32_t, int32_t > >
+                                       m_pairs;
+    ConstraintsRecorder*               m_recorder;
 
     std::default_random_engine         m_random_engine;
 };